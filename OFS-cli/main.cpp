@@ -0,0 +1,592 @@
+#include "Funscript.h"
+#include "FunscriptIO.h"
+#include "FunscriptSimplify.h"
+#include "OFS_Util.h"
+
+#include "OFS_Lua.h"
+#include "OFS_LuaKernels.h"
+#include "OFS_LuaActionView.h"
+
+#include "SDL_thread.h"
+#include "SDL_atomic.h"
+#include "SDL_cpuinfo.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <filesystem>
+
+// headless batch processing of funscripts
+// loads every input, applies the transforms in the order they were passed & writes the result
+// files are processed in parallel, every worker thread owns its own lua vm
+
+struct Transform {
+    enum class Type : int32_t {
+        Simplify,
+        Minimum,
+        RangeExtend,
+        Equalize,
+        Invert,
+        Lua,
+    };
+    Type type;
+    float value = 0.f;
+    int32_t luaIdx = -1;
+};
+
+struct LuaScriptArg {
+    std::string path;
+    // key=value pairs passed with --lua-set, applied when the script calls SetSettings
+    std::vector<std::pair<std::string, std::string>> settings;
+};
+
+struct Job {
+    std::string input;
+    std::string output;
+};
+
+struct CliOptions {
+    std::vector<Transform> transforms;
+    std::vector<LuaScriptArg> luaScripts;
+    std::vector<std::string> inputs;
+    std::vector<Job> jobs;
+    std::string outputDir;
+    bool inPlace = false;
+    bool pretty = false;
+    int32_t threads = 0;
+};
+
+struct Worker {
+    const CliOptions* options = nullptr;
+    SDL_atomic_t* nextJob = nullptr;
+    SDL_atomic_t* failedJobs = nullptr;
+
+    lua_State* L = nullptr;
+    // registry references to the compiled lua scripts
+    std::vector<int> chunks;
+    const LuaScriptArg* currentScript = nullptr;
+};
+
+static void PrintUsage() noexcept
+{
+    std::puts(
+        "usage: OFS_cli [options] <funscript or directory>...\n"
+        "\n"
+        "directories are searched recursively for .funscript files.\n"
+        "transforms are applied in the order they are passed.\n"
+        "every transform works on the whole script.\n"
+        "\n"
+        "transforms:\n"
+        "  --simplify <epsilon>    ramer-douglas-peucker simplification\n"
+        "  --minimum               drops actions which don't change the speed (like \"Save frameless\")\n"
+        "  --range-extend <n>      extends the range of every stroke by n\n"
+        "  --equalize              equalizes the distance between actions\n"
+        "  --invert                inverts all positions\n"
+        "  --lua <script>          runs a lua script, CurrentScript holds the funscript with every action selected\n"
+        "  --lua-set <key=value>   overrides a setting of the last --lua script\n"
+        "\n"
+        "options:\n"
+        "  -o, --output <dir>      output directory, the directory structure of the inputs is kept\n"
+        "  --in-place              overwrite the inputs\n"
+        "  -j, --jobs <n>          number of worker threads (default: cpu count)\n"
+        "  --pretty                write indented json\n"
+        "  -h, --help              show this\n"
+    );
+}
+
+static bool ParseArguments(int argc, char* argv[], CliOptions& options) noexcept
+{
+    auto nextArg = [&](int& i) -> const char* {
+        if (i + 1 >= argc) {
+            LOGF_ERROR("%s expects a value", argv[i]);
+            return nullptr;
+        }
+        return argv[++i];
+    };
+
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* value = nullptr;
+        if (strcmp(arg, "-h") == 0 || strcmp(arg, "--help") == 0) {
+            return false;
+        }
+        else if (strcmp(arg, "-o") == 0 || strcmp(arg, "--output") == 0) {
+            if (!(value = nextArg(i))) return false;
+            options.outputDir = value;
+        }
+        else if (strcmp(arg, "--in-place") == 0) {
+            options.inPlace = true;
+        }
+        else if (strcmp(arg, "-j") == 0 || strcmp(arg, "--jobs") == 0) {
+            if (!(value = nextArg(i))) return false;
+            options.threads = std::max(std::atoi(value), 1);
+        }
+        else if (strcmp(arg, "--pretty") == 0) {
+            options.pretty = true;
+        }
+        else if (strcmp(arg, "--simplify") == 0) {
+            if (!(value = nextArg(i))) return false;
+            options.transforms.push_back({ Transform::Type::Simplify, std::max((float)std::atof(value), 0.f) });
+        }
+        else if (strcmp(arg, "--minimum") == 0) {
+            options.transforms.push_back({ Transform::Type::Minimum });
+        }
+        else if (strcmp(arg, "--range-extend") == 0) {
+            if (!(value = nextArg(i))) return false;
+            options.transforms.push_back({ Transform::Type::RangeExtend, (float)std::atoi(value) });
+        }
+        else if (strcmp(arg, "--equalize") == 0) {
+            options.transforms.push_back({ Transform::Type::Equalize });
+        }
+        else if (strcmp(arg, "--invert") == 0) {
+            options.transforms.push_back({ Transform::Type::Invert });
+        }
+        else if (strcmp(arg, "--lua") == 0) {
+            if (!(value = nextArg(i))) return false;
+            if (!Util::FileExists(value)) {
+                LOGF_ERROR("lua script \"%s\" doesn't exist", value);
+                return false;
+            }
+            Transform transform{ Transform::Type::Lua };
+            transform.luaIdx = options.luaScripts.size();
+            options.transforms.push_back(transform);
+            options.luaScripts.push_back({ value });
+        }
+        else if (strcmp(arg, "--lua-set") == 0) {
+            if (!(value = nextArg(i))) return false;
+            const char* separator = strchr(value, '=');
+            if (options.luaScripts.empty() || separator == nullptr) {
+                LOG_ERROR("--lua-set expects key=value after a --lua script");
+                return false;
+            }
+            options.luaScripts.back().settings.emplace_back(std::string(value, separator), std::string(separator + 1));
+        }
+        else if (arg[0] == '-') {
+            LOGF_ERROR("unknown option %s", arg);
+            return false;
+        }
+        else {
+            options.inputs.emplace_back(arg);
+        }
+    }
+
+    if (options.inputs.empty()) {
+        LOG_ERROR("no inputs");
+        return false;
+    }
+    if (options.transforms.empty()) {
+        LOG_ERROR("no transforms");
+        return false;
+    }
+    if (options.outputDir.empty() == !options.inPlace) {
+        LOG_ERROR("either --output or --in-place is required");
+        return false;
+    }
+    return true;
+}
+
+static void GatherJobs(CliOptions& options) noexcept
+{
+    auto addJob = [&](const std::filesystem::path& input, const std::filesystem::path& relative) {
+        auto& job = options.jobs.emplace_back();
+        job.input = input.u8string();
+        job.output = options.inPlace
+            ? job.input
+            : (Util::PathFromString(options.outputDir) / relative).u8string();
+    };
+
+    for (auto& input : options.inputs) {
+        auto path = Util::PathFromString(input);
+        std::error_code ec;
+        if (std::filesystem::is_directory(path, ec)) {
+            auto iterator = std::filesystem::recursive_directory_iterator(path, ec);
+            for (auto it = std::filesystem::begin(iterator); it != std::filesystem::end(iterator); it.increment(ec)) {
+                if (ec) break;
+                if (it->is_regular_file(ec) && it->path().extension().u8string() == ".funscript") {
+                    addJob(it->path(), it->path().lexically_relative(path));
+                }
+            }
+        }
+        else if (std::filesystem::is_regular_file(path, ec)) {
+            addJob(path, path.filename());
+        }
+        else {
+            LOGF_WARN("\"%s\" doesn't exist", input.c_str());
+        }
+    }
+}
+
+// lua is compiled as c++ and raises errors as exceptions
+// so nothing that can call luaL_error is noexcept
+
+static int LuaSetProgress(lua_State* L)
+{
+    return 0;
+}
+
+// same contract as in OFS, the overrides get written into the table passed by the script
+static int LuaSetSettings(lua_State* L)
+{
+    auto worker = (Worker*)lua_touserdata(L, lua_upvalueindex(1));
+    if (!lua_istable(L, 1)) {
+        lua_settop(L, 0);
+        lua_newtable(L);
+    }
+    lua_settop(L, 1);
+    if (worker->currentScript == nullptr) return 1;
+
+    for (auto& [key, value] : worker->currentScript->settings) {
+        lua_getfield(L, 1, key.c_str());
+        int type = lua_type(L, -1);
+        lua_pop(L, 1);
+        switch (type) {
+            case LUA_TBOOLEAN:
+                lua_pushboolean(L, value == "true" || value == "1");
+                break;
+            case LUA_TNUMBER:
+                if (lua_stringtonumber(L, value.c_str()) == 0) {
+                    return luaL_error(L, "setting \"%s\" expects a number", key.c_str());
+                }
+                break;
+            case LUA_TSTRING:
+                lua_pushstring(L, value.c_str());
+                break;
+            default:
+                return luaL_error(L, "the script has no setting called \"%s\"", key.c_str());
+        }
+        lua_setfield(L, 1, key.c_str());
+    }
+    return 1;
+}
+
+static int LuaLoadFile(lua_State* L, const char* path) noexcept
+{
+    std::vector<uint8_t> file;
+    if (Util::ReadFile(path, file) > 0) {
+        std::string chunkName = std::string("@") + path; // errors show up as path:line
+        return luaL_loadbuffer(L, (const char*)file.data(), file.size(), chunkName.c_str());
+    }
+    lua_pushfstring(L, "failed to read %s", path);
+    return LUA_ERRFILE;
+}
+
+static void AddToLuaPath(lua_State* L, const char* path) noexcept
+{
+    lua_getglobal(L, "package");
+    lua_getfield(L, -1, "path");
+    std::string newPath = lua_tostring(L, -1);
+    newPath.append(";");
+    newPath.append(path);
+    lua_pop(L, 1);
+    lua_pushstring(L, newPath.c_str());
+    lua_setfield(L, -2, "path");
+    lua_pop(L, 1);
+}
+
+// sets up the same environment OFS has and compiles every script once
+static bool InitLua(Worker& worker) noexcept
+{
+    auto L = luaL_newstate();
+    if (L == nullptr) return false;
+    worker.L = L;
+    luaL_openlibs(L);
+
+    // allows scripts to "require" dependencies lua/ & lua/lib/
+    AddToLuaPath(L, Util::Prefpath("lua/lib/?.lua").c_str());
+    AddToLuaPath(L, Util::Prefpath("lua/?.lua").c_str());
+
+    lua_pushcfunction(L, LuaSetProgress);
+    lua_setglobal(L, "SetProgress");
+    lua_pushlightuserdata(L, &worker);
+    lua_pushcclosure(L, LuaSetSettings, 1);
+    lua_setglobal(L, "SetSettings");
+
+    auto initScript = Util::Resource("lua/funscript.lua");
+    if (LuaLoadFile(L, initScript.c_str()) != LUA_OK || lua_pcall(L, 0, 0, 0) != LUA_OK) {
+        LOGF_ERROR("lua init script error: %s", lua_tostring(L, -1));
+        return false;
+    }
+    OFS::lua::RegisterActionView(L);
+    OFS::lua::RegisterKernels(L);
+
+    for (auto& script : worker.options->luaScripts) {
+        if (LuaLoadFile(L, script.path.c_str()) != LUA_OK) {
+            LOGF_ERROR("lua error: %s", lua_tostring(L, -1));
+            return false;
+        }
+        worker.chunks.push_back(luaL_ref(L, LUA_REGISTRYINDEX));
+    }
+    return true;
+}
+
+// pushes a new Funscript table onto the stack
+static void PushFunscript(lua_State* L)
+{
+    lua_getglobal(L, "Funscript");
+    lua_getfield(L, -1, "new");
+    lua_pushvalue(L, -2); // self
+    lua_call(L, 1, 1);
+    lua_remove(L, -2); // pop Funscript
+}
+
+// fills the globals declared in funscript.lua, there's no video & no clipboard
+static int SetupScriptInputs(lua_State* L, const std::string& path, const std::vector<FunscriptAction>& actions)
+{
+    PushFunscript(L);
+    OFS::lua::PushActionArray(L, std::make_shared<const std::vector<FunscriptAction>>());
+    lua_setfield(L, -2, "actions");
+    lua_setglobal(L, "Clipboard");
+
+    lua_pushinteger(L, 1); // !!! lua indexing starts at 1 !!!
+    lua_setglobal(L, "CurrentScriptIdx");
+
+    lua_createtable(L, 1, 0); // LoadedScripts
+    PushFunscript(L);
+    auto title = Util::PathFromString(path);
+    title.replace_extension("");
+    lua_pushstring(L, title.filename().u8string().c_str());
+    lua_setfield(L, -2, "title");
+    lua_pushstring(L, path.c_str());
+    lua_setfield(L, -2, "path");
+    OFS::lua::PushActionArray(L, std::make_shared<const std::vector<FunscriptAction>>(actions));
+    lua_setfield(L, -2, "actions");
+    lua_pushvalue(L, -1);
+    lua_setglobal(L, "CurrentScript");
+    lua_rawseti(L, -2, 1);
+    lua_setglobal(L, "LoadedScripts");
+
+    lua_pushstring(L, "");
+    lua_setglobal(L, "VideoFilePath");
+    lua_pushstring(L, "");
+    lua_setglobal(L, "VideoFileDirectory");
+    lua_pushinteger(L, 0);
+    lua_setglobal(L, "CurrentTimeMs");
+    lua_pushnumber(L, 1000.0 / 60.0);
+    lua_setglobal(L, "FrameTimeMs");
+    lua_pushnumber(L, actions.empty() ? 0.0 : actions.back().at);
+    lua_setglobal(L, "TotalTimeMs");
+    return 0;
+}
+
+static int ClearScriptInputs(lua_State* L)
+{
+    for (auto name : { "Clipboard", "CurrentScript", "LoadedScripts" }) {
+        lua_pushnil(L);
+        lua_setglobal(L, name);
+    }
+    return 0;
+}
+
+// everything which can raise a lua error runs protected
+static int RunScript(lua_State* L)
+{
+    auto worker = (Worker*)lua_touserdata(L, 1);
+    auto path = (const std::string*)lua_touserdata(L, 2);
+    auto actions = (std::vector<FunscriptAction>*)lua_touserdata(L, 3);
+    int chunk = lua_tointeger(L, 4);
+    lua_settop(L, 0);
+
+    // globals defined by the script end up in env and get dropped after the run
+    lua_createtable(L, 0, 16);
+    lua_createtable(L, 0, 1);
+    lua_pushglobaltable(L);
+    lua_setfield(L, -2, "__index");
+    lua_setmetatable(L, -2);
+    const int env = lua_gettop(L);
+
+    SetupScriptInputs(L, *path, *actions);
+
+    lua_rawgeti(L, LUA_REGISTRYINDEX, chunk);
+    lua_pushvalue(L, env);
+    lua_setupvalue(L, -2, 1); // the first upvalue of a chunk is _ENV
+    lua_call(L, 0, 0);
+
+    lua_getfield(L, env, "LoadedScripts");
+    luaL_checktype(L, -1, LUA_TTABLE);
+    lua_rawgeti(L, -1, 1);
+    luaL_checktype(L, -1, LUA_TTABLE);
+    lua_getfield(L, -1, "actions");
+    if (auto array = OFS::lua::ToActionArray(L, -1)) {
+        // untouched arrays stay as they are
+        if (array->Modified()) {
+            *actions = std::move(*array->TakeModified());
+        }
+    }
+    else if (!OFS::lua::ReadActions(L, -1, *actions)) {
+        return luaL_error(L, "failed to read the actions of LoadedScripts[1]");
+    }
+
+    // scripts are allowed to add actions in any order
+    // identical actions (same at & pos) are merged like in OFS
+    auto sameAction = [](auto a, auto b) { return a.at == b.at && a.pos == b.pos; };
+    std::stable_sort(actions->begin(), actions->end(),
+        [](auto a, auto b) { return a.at < b.at || (a.at == b.at && a.pos < b.pos); });
+    actions->erase(std::unique(actions->begin(), actions->end(), sameAction), actions->end());
+    return 0;
+}
+
+static bool RunLuaScript(Worker& worker, int32_t luaIdx, const std::string& path, std::vector<FunscriptAction>& actions) noexcept
+{
+    auto L = worker.L;
+    worker.currentScript = &worker.options->luaScripts[luaIdx];
+    for (auto& action : actions) action.SetSelected(true);
+
+    lua_settop(L, 0);
+    lua_pushcfunction(L, RunScript);
+    lua_pushlightuserdata(L, &worker);
+    lua_pushlightuserdata(L, (void*)&path);
+    lua_pushlightuserdata(L, &actions);
+    lua_pushinteger(L, worker.chunks[luaIdx]);
+    int result = lua_pcall(L, 4, 0, 0);
+    if (result != LUA_OK) {
+        LOGF_ERROR("%s: lua error: %s", path.c_str(), lua_tostring(L, -1));
+    }
+
+    // releases the snapshots held by the globals of this run
+    lua_settop(L, 0);
+    lua_pushcfunction(L, ClearScriptInputs);
+    lua_pcall(L, 0, 0, 0);
+    lua_settop(L, 0);
+    lua_gc(L, LUA_GCCOLLECT, 0);
+    worker.currentScript = nullptr;
+
+    for (auto& action : actions) action.SetSelected(false);
+    return result == LUA_OK;
+}
+
+static bool ProcessJob(Worker& worker, const Job& job) noexcept
+{
+    std::vector<FunscriptAction> actions;
+    nlohmann::json json;
+    if (!OFS::io::LoadFunscript(job.input, actions, json)) {
+        LOGF_ERROR("failed to load \"%s\"", job.input.c_str());
+        return false;
+    }
+
+    // the selection based edits are only available on Funscript
+    auto applyToSelection = [&actions](auto&& edit) {
+        Funscript script;
+        script.SetActions(actions);
+        script.SelectAll();
+        edit(script);
+        actions = script.Actions();
+        for (auto& action : actions) action.SetSelected(false);
+    };
+
+    for (auto& transform : worker.options->transforms) {
+        switch (transform.type) {
+            case Transform::Type::Simplify:
+            {
+                std::vector<FunscriptAction> simplified;
+                simplified.reserve(actions.size());
+                OFS::simplify::RamerDouglasPeucker(actions, transform.value, simplified);
+                actions = std::move(simplified);
+                break;
+            }
+            case Transform::Type::Minimum:
+            {
+                std::vector<FunscriptAction> filtered;
+                OFS::simplify::RemoveRedundantActions(actions, filtered);
+                actions = std::move(filtered);
+                break;
+            }
+            case Transform::Type::RangeExtend:
+                applyToSelection([&](Funscript& script) { script.RangeExtendSelection((int32_t)transform.value); });
+                break;
+            case Transform::Type::Equalize:
+                applyToSelection([](Funscript& script) { script.EqualizeSelection(); });
+                break;
+            case Transform::Type::Invert:
+                applyToSelection([](Funscript& script) { script.InvertSelection(); });
+                break;
+            case Transform::Type::Lua:
+                if (!RunLuaScript(worker, transform.luaIdx, job.input, actions)) return false;
+                break;
+        }
+    }
+
+    auto outputDir = Util::PathFromString(job.output);
+    outputDir.replace_filename("");
+    if (!outputDir.empty() && !Util::CreateDirectories(outputDir)) {
+        return false;
+    }
+    if (!OFS::io::WriteFunscript(job.output, actions, json, worker.options->pretty)) {
+        LOGF_ERROR("failed to write \"%s\"", job.output.c_str());
+        return false;
+    }
+    LOGF_INFO("%s -> %s (%d actions)", job.input.c_str(), job.output.c_str(), (int)actions.size());
+    return true;
+}
+
+static int WorkerThread(void* user) noexcept
+{
+    auto& worker = *(Worker*)user;
+    auto& jobs = worker.options->jobs;
+
+    if (!worker.options->luaScripts.empty() && !InitLua(worker)) {
+        // the jobs are left to the other workers
+        if (worker.L) lua_close(worker.L);
+        worker.L = nullptr;
+        return 1;
+    }
+
+    int32_t idx;
+    while ((idx = SDL_AtomicAdd(worker.nextJob, 1)) < (int32_t)jobs.size()) {
+        if (!ProcessJob(worker, jobs[idx])) {
+            SDL_AtomicAdd(worker.failedJobs, 1);
+        }
+    }
+
+    if (worker.L) lua_close(worker.L);
+    worker.L = nullptr;
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    CliOptions options;
+    if (!ParseArguments(argc, argv, options)) {
+        PrintUsage();
+        return 2;
+    }
+    GatherJobs(options);
+    if (options.jobs.empty()) {
+        LOG_ERROR("no funscripts found");
+        return 1;
+    }
+
+    int32_t threadCount = options.threads > 0 ? options.threads : SDL_GetCPUCount();
+    threadCount = Util::Clamp<int32_t>(threadCount, 1, options.jobs.size());
+
+    SDL_atomic_t nextJob{ 0 };
+    SDL_atomic_t failedJobs{ 0 };
+    std::vector<Worker> workers(threadCount);
+    std::vector<SDL_Thread*> threads;
+    threads.reserve(threadCount);
+
+    auto startTime = std::chrono::high_resolution_clock::now();
+    for (auto& worker : workers) {
+        worker.options = &options;
+        worker.nextJob = &nextJob;
+        worker.failedJobs = &failedJobs;
+        threads.push_back(SDL_CreateThread(WorkerThread, "OFS_cli", &worker));
+    }
+
+    int32_t failedWorkers = 0;
+    for (auto thread : threads) {
+        int status = 1;
+        SDL_WaitThread(thread, &status);
+        failedWorkers += status != 0;
+    }
+    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - startTime);
+
+    int32_t processed = std::min<int32_t>(SDL_AtomicGet(&nextJob), options.jobs.size());
+    int32_t failed = SDL_AtomicGet(&failedJobs) + (options.jobs.size() - processed);
+    LOGF_INFO("processed %d funscripts in %ld ms on %d threads, %d failed",
+        (int)options.jobs.size() - failed, (long)duration.count(), threadCount, failed);
+    return failed > 0 || failedWorkers == threadCount ? 1 : 0;
+}
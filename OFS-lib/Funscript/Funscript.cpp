@@ -7,6 +7,8 @@
 #include "EventSystem.h"
 #include "OFS_Serialization.h"
 #include "FunscriptUndoSystem.h"
+#include "FunscriptSearch.h"
+#include "FunscriptSimplify.h"
 
 #include <algorithm>
 #include <limits>
@@ -40,6 +42,17 @@ void Funscript::setBaseScript(nlohmann::json& base)
 void Funscript::NotifySelectionChanged() noexcept
 {
 	selectionChanged = true;
+	selectionCacheDirty = true;
+}
+
+void Funscript::updateSelectionCache() const noexcept
+{
+	if (!selectionCacheDirty) return;
+	selectionCache.clear();
+	for (auto action : data.Actions) {
+		if (action.IsSelected()) selectionCache.emplace_back(action);
+	}
+	selectionCacheDirty = false;
 }
 
 void Funscript::loadMetadata() noexcept
@@ -78,30 +91,21 @@ void Funscript::startSaveThread(const std::string& path, std::vector<FunscriptAc
 		SaveThreadData* data = static_cast<SaveThreadData*>(user);
 		SDL_LockMutex(data->mutex);
 
-		data->jsonObj["actions"] = nlohmann::json::array();
 		data->jsonObj["version"] = "1.0";
 		data->jsonObj["inverted"] = false;
 		data->jsonObj["range"] = 100; // I think this is mostly ignored anyway
 
 		data->jsonObj.merge_patch(*data->base);
-		auto& actions = data->jsonObj["actions"];
-		for (auto&& action : data->actions) {
-			// a little validation just in case
-			if (action.at < 0)
-				continue;
-
-			nlohmann::json actionObj = {
-				{ "at", action.at },
-				{ "pos", Util::Clamp<int32_t>(action.pos, 0, 100) }
-			};
-			actions.emplace_back(std::move(actionObj));
-	}
+		data->jsonObj.erase("actions");
 
 #ifdef NDEBUG
-		Util::WriteJson(data->jsonObj, data->path.c_str());
+		bool written = OFS::io::WriteFunscript(data->path, data->actions, data->jsonObj);
 #else
-		Util::WriteJson(data->jsonObj, data->path.c_str(), true);
+		bool written = OFS::io::WriteFunscript(data->path, data->actions, data->jsonObj, true);
 #endif
+		if (written && OFS::io::FunscriptCacheEnabled) {
+			OFS::io::WriteFunscriptCache(data->path, data->actions, data->jsonObj);
+		}
 		SDL_UnlockMutex(data->mutex);
 		delete data;
 		return 0;
@@ -118,8 +122,8 @@ void Funscript::update() noexcept
 		ev.type = FunscriptEvents::FunscriptActionsChangedEvent;
 		SDL_PushEvent(&ev);
 
-		// TODO: find out how expensive this is on an already sorted array
-		sortActions(data.Actions);
+		// every edit keeps the actions sorted, no need to sort here anymore
+		FUN_ASSERT(OFS::search::IsSorted(data.Actions), "actions aren't sorted");
 	}
 	if (selectionChanged) {
 		selectionChanged = false;
@@ -129,37 +133,25 @@ void Funscript::update() noexcept
 	}
 }
 
+void Funscript::PublishSnapshot() noexcept
+{
+	if (!snapshotDirty) return;
+	OFS_BENCHMARK(__FUNCTION__);
+	snapshotDirty = false;
+	// the previous snapshot gets freed by whoever drops the last reference
+	std::atomic_store(&actionSnapshot, std::make_shared<const std::vector<FunscriptAction>>(data.Actions));
+}
+
 void Funscript::saveMinium(const std::string& path) noexcept
 {
 	saveMetadata();
 
-	auto& actions = Json["actions"];
-	actions.clear();
-	sortActions(data.Actions);
+	if (!OFS::search::IsSorted(data.Actions)) {
+		sortActions(data.Actions);
+	}
 	
 	std::vector<FunscriptAction> filteredActions;
-	if (data.Actions.size() >= 3) {
-		filteredActions.reserve(data.Actions.size());
-		filteredActions.emplace_back(data.Actions.front());
-		for (int i = 1; i < data.Actions.size() - 1; i++) {
-			auto previous = filteredActions.back();
-			auto current = data.Actions[i];
-			auto next = data.Actions[i + 1];
-
-			float speedPreviousToNext = std::abs(previous.pos - next.pos) / (float)(next.at - previous.at);
-
-			float speedPreviousToCurrent = std::abs(previous.pos - current.pos) / (float)(current.at - previous.at);
-			float speedCurrentToNext = std::abs(current.pos - next.pos) / (float)(next.at - current.at);
-
-			float avgSpeedSegments = (speedPreviousToCurrent + speedCurrentToNext) / 2.f;
-
-			if (std::abs(speedPreviousToNext - avgSpeedSegments) > (speedPreviousToNext * 0.005)) {
-				filteredActions.emplace_back(current);
-			}
-		}
-		filteredActions.emplace_back(data.Actions.back());
-	}
-	else { filteredActions = data.Actions; }
+	OFS::simplify::RemoveRedundantActions(data.Actions, filteredActions);
 
 	startSaveThread(path, std::move(filteredActions), std::move(Json));
 }
@@ -169,31 +161,50 @@ float Funscript::GetPositionAtTime(int32_t time_ms) noexcept
 	if (data.Actions.size() == 0) {	return 0; } 
 	else if (data.Actions.size() == 1) return data.Actions[0].pos;
 
-	for (int i = 0; i < data.Actions.size()-1; i++) {
-		auto& action = data.Actions[i];
-		auto& next = data.Actions[i + 1];
-
-		if (time_ms > action.at && time_ms < next.at) {
-			// interpolate position
-			int32_t last_pos = action.pos;
-			float diff = next.pos - action.pos;
-			float progress = (float)(time_ms - action.at) / (next.at - action.at);
-			
-			float interp = last_pos +(progress * (float)diff);
-			return interp;
-		}
-		else if (action.at == time_ms) {
-			return action.pos;
-		}
+	auto it = OFS::search::LowerBound(data.Actions.begin(), data.Actions.end(), time_ms);
+	if (it == data.Actions.end() || (it == data.Actions.begin() && it->at != time_ms)) {
+		return data.Actions.back().pos;
+	}
+	else if (it->at == time_ms) {
+		return it->pos;
+	}
+
+	// interpolate position
+	auto& action = *(it - 1);
+	auto& next = *it;
+	int32_t last_pos = action.pos;
+	float diff = next.pos - action.pos;
+	float progress = (float)(time_ms - action.at) / (next.at - action.at);
 
+	float interp = last_pos + (progress * (float)diff);
+	return interp;
+}
+
+static void scaleSamples(float* samples, int32_t count, bool clamp) noexcept
+{
+	for (int32_t i = 0; i < count; i++) {
+		float pos = samples[i] * 100.f;
+		samples[i] = clamp ? Util::Clamp(pos, 0.f, 100.f) : pos;
 	}
+}
 
-	return data.Actions.back().pos;
+void Funscript::SamplePositions(float t0, float dt, int32_t count, float* out, bool spline) noexcept
+{
+	UpdateSpline();
+	ScriptSpline.SampleRange(t0, dt, count, out, !spline);
+	scaleSamples(out, count, spline);
+}
+
+void Funscript::SamplePositions(const float* timesMs, int32_t count, float* out, bool spline) noexcept
+{
+	UpdateSpline();
+	ScriptSpline.SampleTimes(timesMs, count, out, !spline);
+	scaleSamples(out, count, spline);
 }
 
 FunscriptAction* Funscript::getAction(FunscriptAction action) noexcept
 {
-	auto it = std::find(data.Actions.begin(), data.Actions.end(), action);
+	auto it = OFS::search::Exact(data.Actions.begin(), data.Actions.end(), action);
 	if (it != data.Actions.end())
 		return &(*it);
 	return nullptr;
@@ -202,36 +213,15 @@ FunscriptAction* Funscript::getAction(FunscriptAction action) noexcept
 FunscriptAction* Funscript::getActionAtTime(std::vector<FunscriptAction>& actions, int32_t time_ms, uint32_t max_error_ms) noexcept
 {
 	// gets an action at a time with a margin of error
-	int32_t smallest_error = std::numeric_limits<int32_t>::max();
-	FunscriptAction* smallest_error_action = nullptr;
-
-	for (int i = 0; i < actions.size(); i++) {
-		auto& action = actions[i];
-		
-		if (action.at > (time_ms + (max_error_ms/2)))
-			break;
-
-		int32_t error = std::abs(time_ms - action.at);
-		if (error <= max_error_ms) {
-			if (error <= smallest_error) {
-				smallest_error = error;
-				smallest_error_action = &action;
-			}
-			else {
-				break;
-			}
-		}
-	}
-	return smallest_error_action;
+	auto it = OFS::search::Closest(actions.begin(), actions.end(), time_ms, max_error_ms);
+	if (it != actions.end())
+		return &(*it);
+	return nullptr;
 }
 
 FunscriptAction* Funscript::getNextActionAhead(int32_t time_ms) noexcept
 {
-	auto it = std::find_if(data.Actions.begin(), data.Actions.end(), 
-		[&](auto& action) {
-			return action.at > time_ms;
-	});
-
+	auto it = OFS::search::Next(data.Actions.begin(), data.Actions.end(), time_ms);
 	if (it != data.Actions.end())
 		return &(*it);
 
@@ -240,28 +230,38 @@ FunscriptAction* Funscript::getNextActionAhead(int32_t time_ms) noexcept
 
 FunscriptAction* Funscript::getPreviousActionBehind(int32_t time_ms) noexcept
 {
-	auto it = std::find_if(data.Actions.rbegin(), data.Actions.rend(),
-		[&](auto& action) {
-			return action.at < time_ms;
-		});
-	
-	if (it != data.Actions.rend())
+	auto it = OFS::search::Previous(data.Actions.begin(), data.Actions.end(), time_ms);
+	if (it != data.Actions.end())
 		return &(*it);
 
 	return nullptr;
 }
 
+void Funscript::restoreActionOrder(FunscriptAction* changed) noexcept
+{
+	// moves an action which had its timestamp edited in place back to its sorted position
+	auto it = data.Actions.begin() + (changed - data.Actions.data());
+	if (it != data.Actions.begin() && *it < *(it - 1)) {
+		auto target = OFS::search::UpperBound(data.Actions.begin(), it, it->at);
+		std::rotate(target, it, it + 1);
+	}
+	else if (it + 1 != data.Actions.end() && *(it + 1) < *it) {
+		auto target = OFS::search::LowerBound(it + 1, data.Actions.end(), it->at);
+		std::rotate(it, it + 1, target);
+	}
+}
+
 void Funscript::AddActionSafe(FunscriptAction newAction) noexcept
 {
-	auto it = std::find_if(data.Actions.begin(), data.Actions.end(), [&](auto&& action) {
-		return newAction.at < action.at;
-		});
+	newAction.SetSelected(false);
+	if (batch.depth > 0) {
+		batch.safeInserts.emplace_back(newAction);
+		return;
+	}
+	auto it = OFS::search::UpperBound(data.Actions.begin(), data.Actions.end(), newAction.at);
 	// checks if there's already an action with the same timestamp
-	auto safety = std::find_if(it > data.Actions.begin() ? it - 1 : data.Actions.begin(), data.Actions.end(),
-		[&](auto&& action) {
-			return newAction.at == action.at;
-		});
-	if (safety == data.Actions.end()) {
+	bool safe = it == data.Actions.begin() || (it - 1)->at != newAction.at;
+	if (safe) {
 		data.Actions.insert(it, newAction);
 		NotifyActionsChanged(true);
 	}
@@ -271,6 +271,74 @@ void Funscript::AddActionSafe(FunscriptAction newAction) noexcept
 	}
 }
 
+void Funscript::CommitBatchEdit() noexcept
+{
+	FUN_ASSERT(batch.depth > 0, "there was no batch edit to commit");
+	if (batch.depth <= 0 || --batch.depth > 0) return;
+	if (batch.inserts.empty() && batch.safeInserts.empty() && batch.removes.empty()) return;
+	OFS_BENCHMARK(__FUNCTION__);
+
+	auto byTime = [](auto& a, auto& b) { return a.at < b.at; };
+	// stable so that inserts with the same timestamp keep the order they were added in
+	std::stable_sort(batch.inserts.begin(), batch.inserts.end(), byTime);
+	std::stable_sort(batch.safeInserts.begin(), batch.safeInserts.end(), byTime);
+	std::sort(batch.removes.begin(), batch.removes.end(), byTime);
+
+	std::vector<FunscriptAction> merged;
+	merged.reserve(data.Actions.size() + batch.inserts.size() + batch.safeInserts.size());
+
+	// removes apply to the merged result of existing actions & inserts
+	// this way adding and removing the same action in one batch cancels out
+	size_t removeIdx = 0;
+	bool removedSelected = false;
+	auto emit = [&](FunscriptAction action) noexcept {
+		while (removeIdx < batch.removes.size() && batch.removes[removeIdx].at < action.at) removeIdx++;
+		for (size_t i = removeIdx; i < batch.removes.size() && batch.removes[i].at == action.at; i++) {
+			if (batch.removes[i].pos == action.pos) {
+				// consumed
+				batch.removes[i].pos = std::numeric_limits<int16_t>::min();
+				removedSelected = removedSelected || action.IsSelected();
+				return;
+			}
+		}
+		merged.emplace_back(action);
+	};
+
+	auto insert = batch.inserts.begin();
+	for (auto action : data.Actions) {
+		// inserts go behind existing actions with the same timestamp like AddAction does
+		for (; insert != batch.inserts.end() && insert->at < action.at; ++insert) emit(*insert);
+		emit(action);
+	}
+	for (; insert != batch.inserts.end(); ++insert) emit(*insert);
+
+	if (!batch.safeInserts.empty()) {
+		std::vector<FunscriptAction> result;
+		result.reserve(merged.size() + batch.safeInserts.size());
+		auto it = merged.begin();
+		for (auto safeAction : batch.safeInserts) {
+			for (; it != merged.end() && it->at < safeAction.at; ++it) result.emplace_back(*it);
+			bool taken = (it != merged.end() && it->at == safeAction.at)
+				|| (!result.empty() && result.back().at == safeAction.at);
+			if (taken) {
+				LOGF_WARN("Failed to add action because there's already an action at %d ms", safeAction.at);
+				continue;
+			}
+			result.emplace_back(safeAction);
+		}
+		for (; it != merged.end(); ++it) result.emplace_back(*it);
+		merged = std::move(result);
+	}
+
+	data.Actions = std::move(merged);
+	batch.inserts.clear();
+	batch.safeInserts.clear();
+	batch.removes.clear();
+
+	if (removedSelected) { NotifySelectionChanged(); }
+	NotifyActionsChanged(true);
+}
+
 bool Funscript::EditAction(FunscriptAction oldAction, FunscriptAction newAction) noexcept
 {
 	// update action
@@ -278,7 +346,7 @@ bool Funscript::EditAction(FunscriptAction oldAction, FunscriptAction newAction)
 	if (act != nullptr) {
 		act->at = newAction.at;
 		act->pos = newAction.pos;
-		checkForInvalidatedActions();
+		restoreActionOrder(act);
 		NotifyActionsChanged(true);
 		return true;
 	}
@@ -289,7 +357,11 @@ void Funscript::AddEditAction(FunscriptAction action, float frameTimeMs) noexcep
 {
 	auto close = getActionAtTime(data.Actions, action.at, frameTimeMs);
 	if (close != nullptr) {
+		bool selected = close->IsSelected();
 		*close = action;
+		close->SetSelected(selected);
+		restoreActionOrder(close);
+		NotifyActionsChanged(true);
 	}
 	else {
 		AddAction(action);
@@ -306,35 +378,27 @@ void Funscript::PasteAction(FunscriptAction paste, int32_t error_ms) noexcept
 	NotifyActionsChanged(true);
 }
 
-void Funscript::checkForInvalidatedActions() noexcept
+void Funscript::RemoveAction(FunscriptAction action) noexcept
 {
-	auto it = std::remove_if(data.selection.begin(), data.selection.end(), [&](auto&& selected) {
-		auto found = getAction(selected);
-		if (found == nullptr)
-			return true;
-		return false;
-	});
-	if (it != data.selection.end()) {
-		data.selection.erase(it);
-		NotifySelectionChanged();
+	if (batch.depth > 0) {
+		batch.removes.emplace_back(action);
+		return;
 	}
-}
-
-void Funscript::RemoveAction(FunscriptAction action, bool checkInvalidSelection) noexcept
-{
-	auto it = std::find(data.Actions.begin(), data.Actions.end(), action);
+	auto it = OFS::search::Exact(data.Actions.begin(), data.Actions.end(), action);
 	if (it != data.Actions.end()) {
+		// the selection lives inside the actions so it can't get invalidated
+		if (it->IsSelected()) { NotifySelectionChanged(); }
 		data.Actions.erase(it);
 		NotifyActionsChanged(true);
-
-		if (checkInvalidSelection) { checkForInvalidatedActions(); }
 	}
 }
 
 void Funscript::RemoveActions(const std::vector<FunscriptAction>& removeActions) noexcept
 {
+	BeginBatchEdit();
 	for (auto&& action : removeActions)
-		RemoveAction(action, false);
+		RemoveAction(action);
+	CommitBatchEdit();
 	NotifyActionsChanged(true);
 }
 
@@ -391,19 +455,22 @@ void Funscript::SetActions(const std::vector<FunscriptAction>& override_with) no
 {
 	data.Actions.clear();
 	data.Actions.assign(override_with.begin(), override_with.end());
-	sortActions(data.Actions);
+	for (auto& action : data.Actions) action.SetSelected(false);
+	NotifySelectionChanged();
+	if (!OFS::search::IsSorted(data.Actions)) {
+		sortActions(data.Actions);
+	}
 	NotifyActionsChanged(true);
 }
 
 void Funscript::RemoveActionsInInterval(int32_t fromMs, int32_t toMs) noexcept
 {
+	if (fromMs > toMs) return;
 	data.Actions.erase(
-		std::remove_if(data.Actions.begin(), data.Actions.end(),
-			[&](auto action) {
-				return action.at >= fromMs && action.at <= toMs;
-			}), data.Actions.end()
+		OFS::search::LowerBound(data.Actions.begin(), data.Actions.end(), fromMs),
+		OFS::search::UpperBound(data.Actions.begin(), data.Actions.end(), toMs)
 	);
-	checkForInvalidatedActions();
+	NotifySelectionChanged();
 	NotifyActionsChanged(true);
 }
 
@@ -481,58 +548,42 @@ void Funscript::RangeExtendSelection(int32_t rangeExtend) noexcept
 	};
 	std::vector<FunscriptAction*> rangeExtendSelection;
 	rangeExtendSelection.reserve(SelectionSize());
-	int selectionOffset = 0;
 	for (auto&& act : data.Actions) {
-		for (int i = selectionOffset; i < data.selection.size(); i++) {
-			if (data.selection[i] == act) {
-				rangeExtendSelection.push_back(&act);
-				selectionOffset = i;
-				break;
-			}
-		}
+		if (act.IsSelected()) rangeExtendSelection.push_back(&act);
 	}
 	if (rangeExtendSelection.size() == 0) { return; }
 	ClearSelection();
 	ExtendRange(rangeExtendSelection, rangeExtend);
+	NotifyActionsChanged(true);
 }
 
 bool Funscript::ToggleSelection(FunscriptAction action) noexcept
 {
-	auto it = std::find(data.selection.begin(), data.selection.end(), action);
-	bool is_selected = it != data.selection.end();
-	if (is_selected) {
-		data.selection.erase(it);
-	}
-	else {
-		data.selection.emplace_back(action);
-	}
+	auto it = OFS::search::Exact(data.Actions.begin(), data.Actions.end(), action);
+	if (it == data.Actions.end()) return false;
+	it->SetSelected(!it->IsSelected());
 	NotifySelectionChanged();
-	return !is_selected;
+	return it->IsSelected();
 }
 
 void Funscript::SetSelection(FunscriptAction action, bool selected) noexcept
 {
-	auto it = std::find(data.selection.begin(), data.selection.end(), action);
-	bool is_selected = it != data.selection.end();
-	if(is_selected && !selected)
-	{
-		data.selection.erase(it);
-	}
-	else if(!is_selected && selected) {
-		data.selection.emplace_back(action);
-		sortSelection();
+	auto it = OFS::search::Exact(data.Actions.begin(), data.Actions.end(), action);
+	if (it != data.Actions.end()) {
+		it->SetSelected(selected);
 	}
 	NotifySelectionChanged();
 }
 
 void Funscript::SelectTopActions()
 {
-	if (data.selection.size() < 3) return;
+	auto& selection = Selection();
+	if (selection.size() < 3) return;
 	std::vector<FunscriptAction> deselect;
-	for (int i = 1; i < data.selection.size() - 1; i++) {
-		auto& prev = data.selection[i - 1];
-		auto& current = data.selection[i];
-		auto& next = data.selection[i + 1];
+	for (int i = 1; i < selection.size() - 1; i++) {
+		auto& prev = selection[i - 1];
+		auto& current = selection[i];
+		auto& next = selection[i + 1];
 
 		auto& min1 = prev.pos < current.pos ? prev : current;
 		auto& min2 = min1.pos < next.pos ? min1 : next;
@@ -548,12 +599,13 @@ void Funscript::SelectTopActions()
 
 void Funscript::SelectBottomActions()
 {
-	if (data.selection.size() < 3) return;
+	auto& selection = Selection();
+	if (selection.size() < 3) return;
 	std::vector<FunscriptAction> deselect;
-	for (int i = 1; i < data.selection.size() - 1; i++) {
-		auto& prev = data.selection[i - 1];
-		auto& current = data.selection[i];
-		auto& next = data.selection[i + 1];
+	for (int i = 1; i < selection.size() - 1; i++) {
+		auto& prev = selection[i - 1];
+		auto& current = selection[i];
+		auto& next = selection[i + 1];
 
 		auto& max1 = prev.pos > current.pos ? prev : current;
 		auto& max2 = max1.pos > next.pos ? max1 : next;
@@ -569,21 +621,17 @@ void Funscript::SelectBottomActions()
 
 void Funscript::SelectMidActions()
 {
-	if (data.selection.size() < 3) return;
-	auto selectionCopy = data.selection;
+	if (SelectionSize() < 3) return;
+	auto selectionCopy = Selection();
 	SelectTopActions();
-	auto topPoints = data.selection;
-	data.selection = selectionCopy;
+	auto topPoints = Selection();
+	SetSelection(selectionCopy);
 	SelectBottomActions();
-	auto bottomPoints = data.selection;
-
-	selectionCopy.erase(std::remove_if(selectionCopy.begin(), selectionCopy.end(),
-		[&](auto val) {
-			return std::any_of(topPoints.begin(), topPoints.end(), [&](auto a) { return a == val; })
-				|| std::any_of(bottomPoints.begin(), bottomPoints.end(), [&](auto a) { return a == val; });
-		}), selectionCopy.end());
-	data.selection = selectionCopy;
-	sortSelection();
+	auto bottomPoints = Selection();
+	SetSelection(selectionCopy);
+
+	for (auto& top : topPoints) SetSelection(top, false);
+	for (auto& bottom : bottomPoints) SetSelection(bottom, false);
 	NotifySelectionChanged();
 }
 
@@ -592,89 +640,100 @@ void Funscript::SelectTime(int32_t from_ms, int32_t to_ms, bool clear) noexcept
 	if(clear)
 		ClearSelection();
 
-	for (auto& action : data.Actions) {
-		if (action.at >= from_ms && action.at <= to_ms) {
-			ToggleSelection(action);
+	if (from_ms <= to_ms) {
+		auto begin = OFS::search::LowerBound(data.Actions.begin(), data.Actions.end(), from_ms);
+		auto end = OFS::search::UpperBound(begin, data.Actions.end(), to_ms);
+		for (auto it = begin; it != end; ++it) {
+			it->SetSelected(!it->IsSelected());
 		}
-		else if (action.at > to_ms)
-			break;
 	}
-
-	if (!clear)
-		sortSelection();
 	NotifySelectionChanged();
 }
 
 void Funscript::SelectAction(FunscriptAction select) noexcept
 {
-	auto action = GetAction(select);
+	auto action = getAction(select);
 	if (action != nullptr) {
-		if (ToggleSelection(select)) {
-			// keep selection ordered for rendering purposes
-			sortSelection();
-		}
+		action->SetSelected(!action->IsSelected());
 		NotifySelectionChanged();
 	}
 }
 
 void Funscript::DeselectAction(FunscriptAction deselect) noexcept
 {
-	auto action = GetAction(deselect);
+	auto action = getAction(deselect);
 	if (action != nullptr)
-		SetSelection(*action, false);
+		action->SetSelected(false);
 	NotifySelectionChanged();
 }
 
 void Funscript::SelectAll() noexcept
 {
-	ClearSelection();
-	data.selection.assign(data.Actions.begin(), data.Actions.end());
+	for (auto& action : data.Actions) action.SetSelected(true);
 	NotifySelectionChanged();
 }
 
-void Funscript::RemoveSelectedActions() noexcept
+void Funscript::ClearSelection() noexcept
 {
-	RemoveActions(data.selection);
-	ClearSelection();
-	//NotifyActionsChanged(); // already called in RemoveActions
+	if (!HasSelection()) return;
+	for (auto& action : data.Actions) action.SetSelected(false);
 	NotifySelectionChanged();
 }
 
-void Funscript::moveActionsTime(std::vector<FunscriptAction*> moving, int32_t time_offset)
+void Funscript::RemoveSelectedActions() noexcept
 {
-	ClearSelection();
-	for (auto move : moving) {
-		move->at += time_offset;
-	}
+	if (!HasSelection()) return;
+	data.Actions.erase(
+		std::remove_if(data.Actions.begin(), data.Actions.end(),
+			[](auto action) { return action.IsSelected(); }),
+		data.Actions.end()
+	);
 	NotifyActionsChanged(true);
+	NotifySelectionChanged();
 }
 
-void Funscript::moveActionsPosition(std::vector<FunscriptAction*> moving, int32_t pos_offset)
+void Funscript::ReplaceSelection(const std::vector<FunscriptAction>& replacement) noexcept
 {
-	ClearSelection();
-	for (auto move : moving) {
-		move->pos += pos_offset;
-		move->pos = Util::Clamp<int16_t>(move->pos, 0, 100);
+	FUN_ASSERT(batch.depth == 0, "ReplaceSelection can't be part of a batch edit");
+	FUN_ASSERT(OFS::search::IsSorted(replacement), "replacement isn't sorted");
+	std::vector<FunscriptAction> merged;
+	merged.reserve(data.Actions.size() + replacement.size());
+
+	auto it = replacement.begin();
+	auto emitReplacement = [&](FunscriptAction action) noexcept {
+		if (!merged.empty() && merged.back().at == action.at) return;
+		action.SetSelected(false);
+		merged.emplace_back(action);
+	};
+	for (auto action : data.Actions) {
+		if (action.IsSelected()) continue;
+		for (; it != replacement.end() && it->at < action.at; ++it) emitReplacement(*it);
+		for (; it != replacement.end() && it->at == action.at; ++it) {} // taken
+		merged.emplace_back(action);
 	}
+	for (; it != replacement.end(); ++it) emitReplacement(*it);
+
+	data.Actions = std::move(merged);
 	NotifyActionsChanged(true);
+	NotifySelectionChanged();
 }
 
 void Funscript::MoveSelectionTime(int32_t time_offset, float frameTimeMs) noexcept
 {
 	if (!HasSelection()) return;
-	std::vector<FunscriptAction*> moving;
+	auto& selection = Selection();
 
-	// faster path when everything is selected
-	if (data.selection.size() == data.Actions.size()) {
+	// everything is selected
+	if (selection.size() == data.Actions.size()) {
 		for (auto& action : data.Actions)
-			moving.push_back(&action);
-		moveActionsTime(moving, time_offset);
-		SelectAll();
+			action.at += time_offset;
+		NotifyActionsChanged(true);
+		NotifySelectionChanged();
 		return;
 	}
 
-	auto prev = GetPreviousActionBehind(data.selection.front().at);
-	auto next = GetNextActionAhead(data.selection.back().at);
+	auto prev = GetPreviousActionBehind(selection.front().at);
+	auto next = GetNextActionAhead(selection.back().at);
 
 	int32_t min_bound = 0;
 	int32_t max_bound = std::numeric_limits<int32_t>::max();
@@ -682,93 +741,80 @@ void Funscript::MoveSelectionTime(int32_t time_offset, float frameTimeMs) noexce
 	if (time_offset > 0) {
 		if (next != nullptr) {
 			max_bound = next->at - frameTimeMs;
-			time_offset = std::min(time_offset, max_bound - data.selection.back().at);
+			time_offset = std::min(time_offset, max_bound - selection.back().at);
 		}
 	}
 	else
 	{
 		if (prev != nullptr) {
 			min_bound = prev->at + frameTimeMs;
-			time_offset = std::max(time_offset, min_bound - data.selection.front().at);
+			time_offset = std::max(time_offset, min_bound - selection.front().at);
 		}
 	}
 
-	for (auto& find : data.selection) {
-		auto m = getAction(find);
-		if(m != nullptr)
-			moving.push_back(m);
+	for (auto& action : data.Actions) {
+		if (action.IsSelected()) action.at += time_offset;
 	}
-
-	ClearSelection();
-	for (auto move : moving) {
-		move->at += time_offset;
-		data.selection.emplace_back(*move);
+	// unselected actions in between the selection can get overtaken
+	if (!OFS::search::IsSorted(data.Actions)) {
+		sortActions(data.Actions);
 	}
 	NotifyActionsChanged(true);
+	NotifySelectionChanged();
 }
 
 void Funscript::MoveSelectionPosition(int32_t pos_offset) noexcept
 {
 	if (!HasSelection()) return;
-	std::vector<FunscriptAction*> moving;
-	
-	// faster path when everything is selected
-	if (data.selection.size() == data.Actions.size()) {
-		for (auto& action : data.Actions)
-			moving.push_back(&action);
-		moveActionsPosition(moving, pos_offset);
-		SelectAll();
-		return;
-	}
-
-	for (auto& find : data.selection) {
-		auto m = getAction(find);
-		if (m != nullptr)
-			moving.push_back(m);
-	}
-
-	ClearSelection();
-	for (auto move : moving) {
-		move->pos += pos_offset;
-		move->pos = Util::Clamp<int16_t>(move->pos, 0, 100);
-		data.selection.emplace_back(*move);
+	for (auto& action : data.Actions) {
+		if (action.IsSelected()) {
+			action.pos += pos_offset;
+			action.pos = Util::Clamp<int16_t>(action.pos, 0, 100);
+		}
 	}
 	NotifyActionsChanged(true);
+	NotifySelectionChanged();
 }
 
-void Funscript::SetSelection(const std::vector<FunscriptAction>& action_to_select, bool unsafe) noexcept
+void Funscript::SetSelection(const std::vector<FunscriptAction>& action_to_select) noexcept
 {
 	ClearSelection();
-	for (auto&& action : action_to_select) {
-		if (unsafe) {
-			data.selection.emplace_back(action);
-		}
-		else {
-			auto it = std::find(data.Actions.begin(), data.Actions.end(), action);
-			if (it != data.Actions.end()) {
-				data.selection.emplace_back(action);
+	if (OFS::search::IsSorted(action_to_select)) {
+		// linear walk
+		auto it = data.Actions.begin();
+		for (auto&& action : action_to_select) {
+			auto found = OFS::search::Exact(it, data.Actions.end(), action);
+			if (found != data.Actions.end()) {
+				found->SetSelected(true);
+				it = found;
 			}
 		}
 	}
-	sortSelection();
+	else {
+		for (auto&& action : action_to_select) {
+			auto it = OFS::search::Exact(data.Actions.begin(), data.Actions.end(), action);
+			if (it != data.Actions.end()) it->SetSelected(true);
+		}
+	}
+	NotifySelectionChanged();
 }
 
 bool Funscript::IsSelected(FunscriptAction action) noexcept
 {
-	auto it = std::find(data.selection.begin(), data.selection.end(), action);
-	return it != data.selection.end();
+	auto it = OFS::search::Exact(data.Actions.begin(), data.Actions.end(), action);
+	return it != data.Actions.end() && it->IsSelected();
 }
 
 void Funscript::EqualizeSelection() noexcept
 {
-	if (data.selection.size() < 3) return;
-	sortSelection(); // might be unnecessary
-	auto first = data.selection.front();
-	auto last = data.selection.back();
+	if (SelectionSize() < 3) return;
+	auto copySelection = Selection();
+	auto first = copySelection.front();
+	auto last = copySelection.back();
 	float duration = last.at - first.at;
-	int32_t step_ms = std::round(duration / (float)(data.selection.size()-1));
+	int32_t step_ms = std::round(duration / (float)(copySelection.size()-1));
 		
-	auto copySelection = data.selection;
+	BeginBatchEdit();
 	RemoveSelectedActions(); // clears selection
 
 	for (int i = 1; i < copySelection.size()-1; i++) {
@@ -778,21 +824,24 @@ void Funscript::EqualizeSelection() noexcept
 
 	for (auto& action : copySelection)
 		AddAction(action);
+	CommitBatchEdit();
 
-	data.selection = std::move(copySelection);
+	SetSelection(copySelection);
 }
 
 void Funscript::InvertSelection() noexcept
 {
-	if (data.selection.size() == 0) return;
-	auto copySelection = data.selection;
+	if (!HasSelection()) return;
+	auto copySelection = Selection();
+	BeginBatchEdit();
 	RemoveSelectedActions();
 	for (auto& act : copySelection)
 	{
 		act.pos = std::abs(act.pos - 100);
 		AddAction(act);
 	}
-	data.selection = copySelection;
+	CommitBatchEdit();
+	SetSelection(copySelection);
 }
 
 int32_t FunscriptEvents::FunscriptActionsChangedEvent = 0;
@@ -15,6 +15,8 @@
 #include "SDL_mutex.h"
 
 #include "FunscriptSpline.h"
+#include "FunscriptSearch.h"
+#include "FunscriptIO.h"
 #include "OFS_Profiling.h"
 
 class FunscriptUndoSystem;
@@ -32,8 +34,8 @@ class Funscript
 {
 public:
 	struct FunscriptData {
+		// the selection is stored inside of the actions see FunscriptAction::IsSelected
 		std::vector<FunscriptAction> Actions;
-		std::vector<FunscriptAction> selection;
 	};
 
 	struct Metadata {
@@ -80,18 +82,32 @@ private:
 	SDL_mutex* saveMutex = nullptr;
 
 	void setBaseScript(nlohmann::json& base);
-	void checkForInvalidatedActions() noexcept;
 	
 	FunscriptData data;
+
+	// immutable copy of the actions for other threads
+	// replaced with std::atomic_store, never modified after it has been published
+	std::shared_ptr<const std::vector<FunscriptAction>> actionSnapshot;
+	bool snapshotDirty = true;
+
+	// materialized selection for callers which need a vector
+	mutable std::vector<FunscriptAction> selectionCache;
+	mutable bool selectionCacheDirty = true;
+	void updateSelectionCache() const noexcept;
+
+	struct BatchEdit {
+		std::vector<FunscriptAction> inserts;
+		std::vector<FunscriptAction> safeInserts;
+		std::vector<FunscriptAction> removes;
+		int32_t depth = 0;
+	} batch;
 	
 	FunscriptAction* getAction(FunscriptAction action) noexcept;
 	FunscriptAction* getActionAtTime(std::vector<FunscriptAction>& actions, int32_t time_ms, uint32_t error_ms) noexcept;
 	FunscriptAction* getNextActionAhead(int32_t time_ms) noexcept;
 	FunscriptAction* getPreviousActionBehind(int32_t time_ms) noexcept;
+	void restoreActionOrder(FunscriptAction* changed) noexcept;
 
-	void moveActionsTime(std::vector<FunscriptAction*> moving, int32_t time_offset);
-	void moveActionsPosition(std::vector<FunscriptAction*> moving, int32_t pos_offset);
-	inline void sortSelection() noexcept { sortActions(data.selection); }
 	inline void sortActions(std::vector<FunscriptAction>& actions) noexcept {
 		OFS_BENCHMARK(__FUNCTION__);
 		std::sort(actions.begin(), actions.end(),
@@ -99,9 +115,12 @@ private:
 		);
 	}
 	inline void addAction(std::vector<FunscriptAction>& actions, FunscriptAction newAction) noexcept {
-		auto it = std::find_if(actions.begin(), actions.end(), [&](auto& action) {
-			return newAction.at < action.at;
-			});
+		newAction.SetSelected(false);
+		if (batch.depth > 0) {
+			batch.inserts.emplace_back(newAction);
+			return;
+		}
+		auto it = OFS::search::UpperBound(actions.begin(), actions.end(), newAction.at);
 		actions.insert(it, newAction);
 		NotifyActionsChanged(true);
 	}
@@ -131,6 +150,16 @@ public:
 			editTime = std::chrono::system_clock::now();
 		}
 		SplineNeedsUpdate = true;
+		selectionCacheDirty = true;
+		snapshotDirty = true;
+	}
+
+	// publishes a new snapshot if the actions changed since the last call
+	// main thread only, called once per frame
+	void PublishSnapshot() noexcept;
+	// can be called from any thread, the snapshot stays valid for as long as it's held
+	inline std::shared_ptr<const std::vector<FunscriptAction>> ActionSnapshot() const noexcept {
+		return std::atomic_load(&actionSnapshot);
 	}
 
 	FunscriptSpline ScriptSpline;
@@ -144,12 +173,16 @@ public:
 	template<class UserType>
 	inline void AllocUser() noexcept;
 
-	inline void rollback(const FunscriptData& data) noexcept { this->data = data; NotifyActionsChanged(true); }
+	inline void rollback(const FunscriptData& data) noexcept { this->data = data; NotifyActionsChanged(true); NotifySelectionChanged(); }
+	inline void rollback(FunscriptData&& data) noexcept { this->data = std::move(data); NotifyActionsChanged(true); NotifySelectionChanged(); }
 
 	void update() noexcept;
 
 	template<class UserType>
 	bool open(const std::string& file, const std::string& usersettings);
+	// finishes opening a script which was already parsed by OFS::io::LoadFunscript
+	template<class UserType>
+	void open(const std::string& file, const std::string& usersettings, std::vector<FunscriptAction>&& actions, nlohmann::json&& json);
 
 	template<class UserType>
 	void save(const std::string& usersettings) noexcept { save<UserType>(current_path, usersettings, true); }
@@ -164,7 +197,7 @@ public:
 	}
 
 	const FunscriptData& Data() const noexcept { return data; }
-	const std::vector<FunscriptAction>& Selection() const noexcept { return data.selection; }
+	const std::vector<FunscriptAction>& Selection() const noexcept { updateSelectionCache(); return selectionCache; }
 	const std::vector<FunscriptAction>& Actions() const noexcept { return data.Actions; }
 
 	inline const FunscriptAction* GetAction(FunscriptAction action) noexcept { return getAction(action); }
@@ -174,6 +207,11 @@ public:
 	inline const FunscriptAction* GetClosestAction(int32_t time_ms) noexcept { return getActionAtTime(data.Actions, time_ms, std::numeric_limits<uint32_t>::max()); }
 
 	float GetPositionAtTime(int32_t time_ms) noexcept;
+	// batch versions of GetPositionAtTime & SplineClamped, positions are 0 to 100
+	// fills out[i] with the position at t0 + i * dt
+	void SamplePositions(float t0, float dt, int32_t count, float* out, bool spline) noexcept;
+	// fills out[i] with the position at timesMs[i], timesMs has to be sorted
+	void SamplePositions(const float* timesMs, int32_t count, float* out, bool spline) noexcept;
 	
 	inline void AddAction(FunscriptAction newAction) noexcept { addAction(data.Actions, newAction); }
 	void AddActionSafe(FunscriptAction newAction) noexcept;
@@ -181,13 +219,20 @@ public:
 	bool EditAction(FunscriptAction oldAction, FunscriptAction newAction) noexcept;
 	void AddEditAction(FunscriptAction action, float frameTimeMs) noexcept;
 	void PasteAction(FunscriptAction paste, int32_t error_ms) noexcept;
-	void RemoveAction(FunscriptAction action, bool checkInvalidSelection = true) noexcept;
+	void RemoveAction(FunscriptAction action) noexcept;
 	void RemoveActions(const std::vector<FunscriptAction>& actions) noexcept;
 
 	std::vector<FunscriptAction> GetLastStroke(int32_t time_ms) noexcept;
 
 	void SetActions(const std::vector<FunscriptAction>& override_with) noexcept;
 
+	// batch editing
+	// AddAction, AddActionSafe & RemoveAction calls in between Begin & Commit are collected
+	// and merged into the actions in a single pass when the outermost batch gets committed.
+	// queries don't see the pending edits until then.
+	inline void BeginBatchEdit() noexcept { batch.depth++; }
+	void CommitBatchEdit() noexcept;
+
 	inline bool HasUnsavedEdits() const { return unsavedEdits; }
 	inline const std::chrono::system_clock::time_point& EditTime() const { return editTime; }
 
@@ -205,28 +250,33 @@ public:
 	void DeselectAction(FunscriptAction deselect) noexcept;
 	void SelectAll() noexcept;
 	void RemoveSelectedActions() noexcept;
+	// removes the selection & merges the sorted replacement in a single pass
+	// replacement actions which collide with an unselected action are dropped
+	void ReplaceSelection(const std::vector<FunscriptAction>& replacement) noexcept;
 	void MoveSelectionTime(int32_t time_offset, float frameTimeMs) noexcept;
 	void MoveSelectionPosition(int32_t pos_offset) noexcept;
-	inline bool HasSelection() const noexcept { return data.selection.size() > 0; }
-	inline int32_t SelectionSize() const noexcept { return data.selection.size(); }
-	inline void ClearSelection() noexcept { data.selection.clear(); }
-	inline const FunscriptAction* GetClosestActionSelection(int32_t time_ms) noexcept { return getActionAtTime(data.selection, time_ms, std::numeric_limits<int32_t>::max()); }
+	inline bool HasSelection() const noexcept { return SelectionSize() > 0; }
+	inline int32_t SelectionSize() const noexcept { updateSelectionCache(); return selectionCache.size(); }
+	void ClearSelection() noexcept;
+	inline const FunscriptAction* GetClosestActionSelection(int32_t time_ms) noexcept { updateSelectionCache(); return getActionAtTime(selectionCache, time_ms, std::numeric_limits<int32_t>::max()); }
 	
-	void SetSelection(const std::vector<FunscriptAction>& action_to_select, bool unsafe) noexcept;
+	void SetSelection(const std::vector<FunscriptAction>& action_to_select) noexcept;
 	bool IsSelected(FunscriptAction action) noexcept;
 
 	void EqualizeSelection() noexcept;
 	void InvertSelection() noexcept;
 
 
-	inline const float Spline(float timeMs) noexcept {
-		auto& actions = Actions();
+	inline void UpdateSpline() noexcept {
 		if (SplineNeedsUpdate) {
-			ScriptSpline.Update(actions);
+			ScriptSpline.Update(Actions());
 			SplineNeedsUpdate = false;
 		}
+	}
 
-		return ScriptSpline.Sample(actions, timeMs);
+	inline const float Spline(float timeMs) noexcept {
+		UpdateSpline();
+		return ScriptSpline.Sample(timeMs);
 	}
 
 	inline const float SplineClamped(float timeMs) noexcept {
@@ -268,35 +318,32 @@ template<class UserSettings>
 inline bool Funscript::open(const std::string& file, const std::string& usersettings)
 {
 	OFS_BENCHMARK(__FUNCTION__);
-	current_path = file;
-	scriptOpened = true;
+	std::vector<FunscriptAction> actions;
+	nlohmann::json json;
+	bool parsed = OFS::io::FunscriptCacheEnabled
+		? OFS::io::LoadFunscriptCached(file, actions, json)
+		: OFS::io::LoadFunscript(file, actions, json);
+
+	if (!parsed) {
+		current_path = file;
+		scriptOpened = false;
+		LOGF_ERROR("Failed to parse funscript. \"%s\"", file.c_str());
+		return false;
+	}
 
-	{
-		nlohmann::json json;
-		json = Util::LoadJson(file, &scriptOpened);
+	open<UserSettings>(file, usersettings, std::move(actions), std::move(json));
+	return true;
+}
 
-		if (!scriptOpened || !json.is_object() && json["actions"].is_array()) {
-			LOGF_ERROR("Failed to parse funscript. \"%s\"", file.c_str());
-			return false;
-		}
+template<class UserSettings>
+inline void Funscript::open(const std::string& file, const std::string& usersettings, std::vector<FunscriptAction>&& actions, nlohmann::json&& json)
+{
+	current_path = file;
+	scriptOpened = true;
 
-		setBaseScript(json);
-		Json = std::move(json);
-	}
-	auto actions = Json["actions"];
-	data.Actions.clear();
-
-	std::set<FunscriptAction> actionSet;
-	if (actions.is_array()) {
-		for (auto& action : actions) {
-			int32_t time_ms = action["at"];
-			int32_t pos = action["pos"];
-			if (time_ms >= 0) {
-				actionSet.emplace(time_ms, pos);
-			}
-		}
-	}
-	data.Actions.assign(actionSet.begin(), actionSet.end());
+	setBaseScript(json);
+	Json = std::move(json);
+	data.Actions = std::move(actions);
 
 	loadMetadata();
 	AllocUser<UserSettings>();	
@@ -316,7 +363,6 @@ inline bool Funscript::open(const std::string& file, const std::string& usersett
 	Json.erase("range");
 	Json.erase("OpenFunscripter");
 	Json.erase("metadata");
-	return true;
 }
 
 template<class UserSettings>
@@ -327,11 +373,10 @@ inline void Funscript::save(const std::string& path, const std::string& usersett
 	saveMetadata();
 	saveSettings<UserSettings>(usersettings, static_cast<UserSettings*>(userdata.get()));
 
-	auto& actions = Json["actions"];
-	actions.clear();
-
 	// make sure actions are sorted
-	sortActions(data.Actions);
+	if (!OFS::search::IsSorted(data.Actions)) {
+		sortActions(data.Actions);
+	}
 
 	if (override_location) {
 		current_path = path;
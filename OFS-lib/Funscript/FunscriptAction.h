@@ -12,9 +12,20 @@ struct FunscriptAction
 public:
 	int32_t at;
 	int16_t pos;
-	uint8_t flags; // unused
+	uint8_t flags;
 	uint8_t tag;
 
+	enum Flags : uint8_t {
+		// the selection of a script is stored right inside the actions
+		// this way it's always in sync with edits and membership is O(1)
+		Selected = 1 << 0,
+	};
+
+	inline bool IsSelected() const noexcept { return flags & Flags::Selected; }
+	inline void SetSelected(bool selected) noexcept {
+		flags = selected ? flags | Flags::Selected : flags & ~Flags::Selected;
+	}
+
 	FunscriptAction() noexcept
 		: at(std::numeric_limits<int32_t>::min()), pos(std::numeric_limits<int16_t>::min()), flags(0), tag(0) {
 		static_assert(sizeof(FunscriptAction) == 8);
@@ -59,7 +70,7 @@ struct FunscriptActionHashfunction
 {
 	inline std::size_t operator()(FunscriptAction s) const noexcept
 	{
-		static_assert(sizeof(FunscriptAction) == sizeof(int64_t));
-		return *(int64_t*)&s;
+		// only at & pos take part in equality
+		return ((uint64_t)(uint32_t)s.at << 16) | (uint16_t)s.pos;
 	}
 };
\ No newline at end of file
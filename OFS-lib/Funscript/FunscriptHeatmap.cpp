@@ -3,17 +3,13 @@
 #include "OFS_Profiling.h"
 #include <array>
 
-void OFS::UpdateHeatmapGradient(float totalDurationMs, ImGradient& grad, const std::vector<FunscriptAction>& actions) noexcept
-{
-    OFS_BENCHMARK(__FUNCTION__);
-    grad.clear();
-    grad.addMark(0.f, IM_COL32(0, 0, 0, 255));
-    grad.addMark(1.f, IM_COL32(0, 0, 0, 255));
-
-    if (actions.size() == 0) {
-        return;
-    }
+// this comes fairly close to what ScriptPlayer's heatmap looks like
+static constexpr float kernel_size_ms = 2500.f;
+static constexpr float max_actions_in_kernel = 24.5f / (5.f / (kernel_size_ms / 1000.f));
+static constexpr int32_t segment_gap_ms = 10000;
 
+OFS::HeatmapBuilder::HeatmapBuilder() noexcept
+{
     std::array<ImColor, 6> heatColor {
         IM_COL32(0x00, 0x00, 0x00, 0xFF),
         IM_COL32(0x1E, 0x90, 0xFF, 0xFF),
@@ -23,111 +19,180 @@ void OFS::UpdateHeatmapGradient(float totalDurationMs, ImGradient& grad, const s
         IM_COL32(0xFF, 0x00, 0x00, 0xFF),
     };
 
-
-    ImGradient HeatMap;
     float pos = 0.0f;
     for (auto& col : heatColor) {
-        HeatMap.addMark(pos, col);
+        heatMap.addMark(pos, col);
         pos += (1.f / (heatColor.size() - 1));
     }
-    HeatMap.refreshCache();
-
-    auto getSegments = [](const std::vector<FunscriptAction>& actions, int32_t gapDurationMs) -> std::vector<std::vector<FunscriptAction>> {
-        int prev_direction = 0; // 0 neutral 0< up 0> down
-        std::vector<std::vector<FunscriptAction>> segments;
-        {
-            FunscriptAction previous(0, 0);
-
-            for (auto& action : actions)
-            {
-                if (previous.pos == action.pos) {
-                    continue;
-                }
-
-                // filter out actions which don't change direction
-                int direction = action.pos - previous.pos;
-                if (direction > 0 && prev_direction > 0) {
-                    previous = action;
-                    continue;
-                }
-                else if (direction < 0 && prev_direction < 0) {
-                    previous = action;
-                    continue;
-                }
-
-                prev_direction = direction;
-
-                if (action.at - previous.at >= gapDurationMs) {
-                    segments.emplace_back();
-                }
-                if (segments.size() == 0) { segments.emplace_back(); }
-                segments.back().emplace_back(action);
-
-                previous = action;
-            }
+    heatMap.refreshCache();
+}
+
+void OFS::HeatmapBuilder::finishKernel(State& state) noexcept
+{
+    // a segment which is a single point in time has nothing in its kernel
+    int32_t actionsInKernel = state.segmentFront == state.segmentBack ? 0 : state.kernelCount;
+    state.kernelOffset += kernel_size_ms;
+    state.kernelCount = state.kernelEndCount;
+    state.kernelEndCount = 0;
+
+    auto& samples = state.samples;
+    float actionsRelToMax = Util::Clamp((float)actionsInKernel / max_actions_in_kernel, 0.0f, 1.0f);
+    if (samples.count == MaxSamples) {
+        std::copy(samples.values.begin() + 1, samples.values.end(), samples.values.begin());
+        samples.count--;
+    }
+    samples.values[samples.count++] = actionsRelToMax;
 
-            return segments;
+    if (samples.count > 1) {
+        float result = 0.f;
+        for (int32_t i = 0; i < samples.count; i++) {
+            result += samples.values[i];
         }
-    };
+        actionsRelToMax = result / (float)samples.count;
+    }
 
+    ImColor color(0.f, 0.f, 0.f, 1.f);
+    heatMap.getColorAt(actionsRelToMax, (float*)&color.Value);
+    marks.push_back({ state.kernelOffset, color });
+}
 
-    // this comes fairly close to what ScriptPlayer's heatmap looks like
-    constexpr float kernel_size_ms = 2500.f;
-    constexpr float max_actions_in_kernel = 24.5f / (5.f / (kernel_size_ms / 1000.f));
+void OFS::HeatmapBuilder::finishSegment(State& state) noexcept
+{
+    // the last action always lies in the current kernel, nothing comes after it
+    finishKernel(state);
+    marks.push_back({ state.kernelOffset + 1.f, IM_COL32(0, 0, 0, 255) });
+    state.inSegment = false;
+}
 
-    ImColor color(0.f, 0.f, 0.f, 1.f);
+void OFS::HeatmapBuilder::addAction(State& state, FunscriptAction action) noexcept
+{
+    if (!state.inSegment || action.at - state.previous.at >= segment_gap_ms) {
+        if (state.inSegment) {
+            finishSegment(state);
+        }
+        state.inSegment = true;
+        state.segmentFront = action.at;
+        state.kernelOffset = action.at;
+        state.kernelCount = 0;
+        state.kernelEndCount = 0;
+        marks.push_back({ state.kernelOffset, IM_COL32(0, 0, 0, 255) });
+    }
 
-    constexpr int32_t max_samples = 3;
-    std::vector<float> samples;
-    samples.reserve(max_samples);
-
-    auto segments = getSegments(actions, 10000);
-    for (auto& segment : segments) {
-        const float durationMs = segment.back().at - segment.front().at;
-        float kernel_offset = segment.front().at;
-        grad.addMark(kernel_offset / totalDurationMs, IM_COL32(0, 0, 0, 255));
-        do {
-            int actions_in_kernel = 0;
-            float kernel_start = kernel_offset;
-            float kernel_end = kernel_offset + kernel_size_ms;
-
-            if (kernel_offset < segment.back().at)
-            {
-                for (int i = 0; i < segment.size(); i++) {
-                    auto& action = segment[i];
-                    if (action.at >= kernel_start && action.at <= kernel_end)
-                        actions_in_kernel++;
-                    else if (action.at > kernel_end)
-                        break;
-                }
-            }
-            kernel_offset += kernel_size_ms;
+    // kernels are finished once an action lies behind them
+    // an action right on the end of a kernel belongs to the next one as well
+    state.segmentBack = action.at;
+    while (action.at > state.kernelOffset + kernel_size_ms) {
+        finishKernel(state);
+    }
+    state.kernelCount++;
+    if (action.at == state.kernelOffset + kernel_size_ms) {
+        state.kernelEndCount++;
+    }
+}
 
-            float actionsRelToMax = Util::Clamp((float)actions_in_kernel / max_actions_in_kernel, 0.0f, 1.0f);
-            if (samples.size() == max_samples + 1) {
-                samples.erase(samples.begin());
-            }
-            samples.emplace_back(actionsRelToMax);
-
-            auto getAverage = [](std::vector<float>& samples) {
-                float result = 0.f;
-                for (auto&& sample : samples) {
-                    result += sample;
-                }
-                result /= (float)samples.size();
-                return result;
-            };
-
-            if (samples.size() > 1) {
-                actionsRelToMax = getAverage(samples);
+void OFS::HeatmapBuilder::Update(std::shared_ptr<const std::vector<FunscriptAction>> newActions) noexcept
+{
+    OFS_BENCHMARK(__FUNCTION__);
+    if (newActions == actions) {
+        return;
+    }
+    static const std::vector<FunscriptAction> empty;
+    const auto& oldRef = actions ? *actions : empty;
+    const auto& newRef = newActions ? *newActions : empty;
+    const size_t oldSize = oldRef.size();
+    const size_t newSize = newRef.size();
+    const size_t minSize = std::min(oldSize, newSize);
+
+    // the edited range is everything between the common prefix & the common suffix
+    const size_t prefix = std::mismatch(oldRef.begin(), oldRef.begin() + minSize, newRef.begin()).first - oldRef.begin();
+    if (prefix == oldSize && prefix == newSize) {
+        actions = std::move(newActions);
+        return;
+    }
+    const size_t suffix = std::mismatch(oldRef.rbegin(), oldRef.rbegin() + (minSize - prefix), newRef.rbegin()).first - oldRef.rbegin();
+
+    // resume at the last checkpoint in front of the first change
+    // everything before it only depends on unchanged actions
+    auto resume = std::upper_bound(checkpoints.begin(), checkpoints.end(), prefix,
+        [](size_t idx, auto& checkpoint) { return idx < checkpoint.actionIdx; });
+
+    Checkpoint start{ 0, 0 };
+    if (resume != checkpoints.begin()) {
+        start = *(resume - 1);
+    }
+    oldCheckpoints.assign(resume, checkpoints.end());
+    checkpoints.erase(resume, checkpoints.end());
+    oldMarks.assign(marks.begin() + start.markIdx, marks.end());
+    marks.resize(start.markIdx);
+    const size_t oldMarkBase = start.markIdx;
+
+    // once a checkpoint behind the edit has the same state as before
+    // the rest of the heatmap can't have changed and gets copied over
+    auto reuseTail = [&](const Checkpoint& current) noexcept -> bool {
+        if (current.actionIdx < newSize - suffix) return false;
+        size_t oldIdx = current.actionIdx - newSize + oldSize;
+        auto it = std::lower_bound(oldCheckpoints.begin(), oldCheckpoints.end(), oldIdx,
+            [](auto& checkpoint, size_t idx) { return checkpoint.actionIdx < idx; });
+        if (it == oldCheckpoints.end() || it->actionIdx != oldIdx || !(it->state == current.state)) return false;
+
+        size_t markOffset = it->markIdx - oldMarkBase;
+        for (; it != oldCheckpoints.end(); ++it) {
+            auto checkpoint = *it;
+            checkpoint.actionIdx = checkpoint.actionIdx - oldSize + newSize;
+            checkpoint.markIdx = checkpoint.markIdx - oldMarkBase - markOffset + marks.size();
+            checkpoints.emplace_back(checkpoint);
+        }
+        marks.insert(marks.end(), oldMarks.begin() + markOffset, oldMarks.end());
+        return true;
+    };
+
+    actions = std::move(newActions);
+    State state = start.state;
+    size_t checkpointMarks = marks.size();
+    bool tailReused = false;
+
+    for (size_t i = start.actionIdx; i < newSize; i++) {
+        if (marks.size() != checkpointMarks) {
+            Checkpoint checkpoint{ i, marks.size(), state };
+            if (reuseTail(checkpoint)) {
+                tailReused = true;
+                break;
             }
+            checkpoints.emplace_back(checkpoint);
+            checkpointMarks = marks.size();
+        }
 
-            HeatMap.getColorAt(actionsRelToMax, (float*)&color.Value);
-            float markPos = kernel_offset / totalDurationMs;
-            grad.addMark(markPos, color);
+        auto action = newRef[i];
+        if (state.previous.pos == action.pos) {
+            continue;
+        }
+
+        // filter out actions which don't change direction
+        int direction = action.pos - state.previous.pos;
+        if ((direction > 0 && state.prevDirection > 0) || (direction < 0 && state.prevDirection < 0)) {
+            state.previous = action;
+            continue;
+        }
+
+        addAction(state, action);
+        state.prevDirection = direction;
+        state.previous = action;
+    }
+
+    if (!tailReused && state.inSegment) {
+        finishSegment(state);
+    }
+}
+
+void OFS::HeatmapBuilder::BuildGradient(float totalDurationMs, ImGradient& grad) const noexcept
+{
+    OFS_BENCHMARK(__FUNCTION__);
+    grad.clear();
+    grad.addMark(0.f, IM_COL32(0, 0, 0, 255));
+    grad.addMark(1.f, IM_COL32(0, 0, 0, 255));
 
-        } while (kernel_offset < (segment.front().at + durationMs));
-        grad.addMark((kernel_offset + 1.f) / totalDurationMs, IM_COL32(0, 0, 0, 255));
+    for (auto& mark : marks) {
+        grad.addMark(mark.timeMs / totalDurationMs, mark.color);
     }
     grad.refreshCache();
 }
@@ -2,6 +2,80 @@
 #include "GradientBar.h"
 #include "FunscriptAction.h"
 
+#include <vector>
+#include <memory>
+#include <array>
+#include <cstdint>
+#include <algorithm>
+
 namespace OFS {
-	void UpdateHeatmapGradient(float totalDurationMs , ImGradient& grad, const std::vector<FunscriptAction>& actions) noexcept;
-}
\ No newline at end of file
+	// computes the heatmap shown in the timeline
+	// the result of the last update is kept around together with the state of the computation after every kernel.
+	// an edit resumes at the kernel in front of the first changed action and the old marks get copied over
+	// as soon as the state matches the one of the last update again.
+	// not thread safe, but it doesn't matter on which thread it gets updated
+	class HeatmapBuilder
+	{
+	public:
+		struct Mark {
+			float timeMs;
+			ImColor color;
+		};
+	private:
+		static constexpr int32_t MaxSamples = 4;
+		struct SampleWindow {
+			std::array<float, MaxSamples> values;
+			int32_t count = 0;
+
+			inline bool operator==(const SampleWindow& b) const noexcept {
+				return count == b.count && std::equal(values.begin(), values.begin() + count, b.values.begin());
+			}
+		};
+		// everything carried from one action to the next
+		struct State {
+			FunscriptAction previous = FunscriptAction(0, 0);
+			int32_t prevDirection = 0; // 0 neutral 0< up 0> down
+			bool inSegment = false;
+			int32_t segmentFront = 0;
+			int32_t segmentBack = 0;
+			float kernelOffset = 0.f; // start of the current kernel, the grid is anchored at the segment front
+			int32_t kernelCount = 0; // actions in the current kernel
+			int32_t kernelEndCount = 0; // actions right on the end of the current kernel, they count for the next one too
+			SampleWindow samples;
+
+			inline bool operator==(const State& b) const noexcept {
+				return previous == b.previous
+					&& (prevDirection > 0) == (b.prevDirection > 0) && (prevDirection < 0) == (b.prevDirection < 0)
+					&& inSegment == b.inSegment && segmentFront == b.segmentFront && segmentBack == b.segmentBack
+					&& kernelOffset == b.kernelOffset && kernelCount == b.kernelCount && kernelEndCount == b.kernelEndCount
+					&& samples == b.samples;
+			}
+		};
+		// the state in front of an action, one gets taken after every finished kernel
+		struct Checkpoint {
+			size_t actionIdx;
+			size_t markIdx;
+			State state;
+		};
+
+		ImGradient heatMap;
+		std::shared_ptr<const std::vector<FunscriptAction>> actions;
+		std::vector<Checkpoint> checkpoints;
+		std::vector<Mark> marks;
+
+		// scratch buffers reused between updates
+		std::vector<Checkpoint> oldCheckpoints;
+		std::vector<Mark> oldMarks;
+
+		void addAction(State& state, FunscriptAction action) noexcept;
+		void finishKernel(State& state) noexcept;
+		void finishSegment(State& state) noexcept;
+	public:
+		HeatmapBuilder() noexcept;
+
+		// takes a snapshot as published by the script, it's held until the next update
+		void Update(std::shared_ptr<const std::vector<FunscriptAction>> newActions) noexcept;
+		void BuildGradient(float totalDurationMs, ImGradient& grad) const noexcept;
+		inline const std::vector<Mark>& Marks() const noexcept { return marks; }
+	};
+}
@@ -0,0 +1,491 @@
+#include "FunscriptIO.h"
+#include "OFS_Util.h"
+#include "OFS_Profiling.h"
+#include "OFS_MappedFile.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+
+// forwards everything except the "actions" array to the regular dom parser
+// actions get written straight into the vector
+class FunscriptSaxHandler
+{
+	using json = nlohmann::json;
+	nlohmann::detail::json_sax_dom_parser<json> dom;
+	std::vector<FunscriptAction>& actions;
+
+	enum class Field : int32_t {
+		None,
+		At,
+		Pos
+	};
+
+	int32_t depth = 0;
+	// depth of the actions array while parsing it otherwise -1
+	int32_t actionsDepth = -1;
+	// the "actions" key is held back until it's clear that the value is an array
+	bool pendingActionsKey = false;
+
+	Field field = Field::None;
+	int32_t at = 0;
+	int32_t pos = 0;
+	bool hasAt = false;
+	bool hasPos = false;
+
+	inline bool inActions() const noexcept { return actionsDepth >= 0; }
+	inline bool inAction() const noexcept { return inActions() && depth == actionsDepth + 1; }
+
+	inline bool flushActionsKey() noexcept
+	{
+		if (!pendingActionsKey) return true;
+		pendingActionsKey = false;
+		std::string key = "actions";
+		return dom.key(key);
+	}
+
+	template<typename T>
+	inline bool number(T value) noexcept
+	{
+		if (!inActions()) return flushActionsKey() && dom_number(value);
+		if (inAction()) {
+			switch (field) {
+			case Field::At:
+				at = static_cast<int32_t>(value);
+				hasAt = true;
+				break;
+			case Field::Pos:
+				pos = static_cast<int32_t>(value);
+				hasPos = true;
+				break;
+			default:
+				break;
+			}
+			field = Field::None;
+		}
+		return true;
+	}
+
+	inline bool dom_number(json::number_integer_t value) noexcept { return dom.number_integer(value); }
+	inline bool dom_number(json::number_unsigned_t value) noexcept { return dom.number_unsigned(value); }
+	inline bool dom_number(json::number_float_t value) noexcept { return dom.number_float(value, std::string()); }
+
+public:
+	// set when the actions weren't sorted or contained duplicate timestamps
+	bool needsFixup = false;
+
+	FunscriptSaxHandler(json& root, std::vector<FunscriptAction>& actions) noexcept
+		: dom(root, false), actions(actions) {}
+
+	bool null() noexcept
+	{
+		if (!inActions()) return flushActionsKey() && dom.null();
+		field = Field::None;
+		return true;
+	}
+
+	bool boolean(bool val) noexcept
+	{
+		if (!inActions()) return flushActionsKey() && dom.boolean(val);
+		field = Field::None;
+		return true;
+	}
+
+	bool number_integer(json::number_integer_t val) noexcept { return number(val); }
+	bool number_unsigned(json::number_unsigned_t val) noexcept { return number(val); }
+	bool number_float(json::number_float_t val, const json::string_t& s) noexcept
+	{
+		if (!inActions()) return flushActionsKey() && dom.number_float(val, s);
+		return number(val);
+	}
+
+	bool string(json::string_t& val) noexcept
+	{
+		if (!inActions()) return flushActionsKey() && dom.string(val);
+		field = Field::None;
+		return true;
+	}
+
+	bool binary(json::binary_t& val) noexcept
+	{
+		if (!inActions()) return flushActionsKey() && dom.binary(val);
+		field = Field::None;
+		return true;
+	}
+
+	bool start_object(std::size_t elements) noexcept
+	{
+		depth++;
+		if (!inActions()) return flushActionsKey() && dom.start_object(elements);
+		if (inAction()) {
+			hasAt = false;
+			hasPos = false;
+		}
+		field = Field::None;
+		return true;
+	}
+
+	bool key(json::string_t& val) noexcept
+	{
+		if (!inActions()) {
+			if (depth == 1 && val == "actions") {
+				pendingActionsKey = true;
+				return true;
+			}
+			return dom.key(val);
+		}
+		if (inAction()) {
+			field = val == "at" ? Field::At
+				: val == "pos" ? Field::Pos
+				: Field::None;
+		}
+		return true;
+	}
+
+	bool end_object() noexcept
+	{
+		if (!inActions()) {
+			depth--;
+			return dom.end_object();
+		}
+		if (inAction() && hasAt && hasPos && at >= 0) {
+			if (!actions.empty() && at <= actions.back().at) {
+				needsFixup = true;
+			}
+			actions.emplace_back(at, pos);
+		}
+		depth--;
+		return true;
+	}
+
+	bool start_array(std::size_t elements) noexcept
+	{
+		depth++;
+		if (!inActions()) {
+			if (pendingActionsKey) {
+				pendingActionsKey = false;
+				actionsDepth = depth;
+				return true;
+			}
+			return dom.start_array(elements);
+		}
+		field = Field::None;
+		return true;
+	}
+
+	bool end_array() noexcept
+	{
+		if (!inActions()) {
+			depth--;
+			return dom.end_array();
+		}
+		if (depth == actionsDepth) {
+			actionsDepth = -1;
+		}
+		depth--;
+		return true;
+	}
+
+	bool parse_error(std::size_t position, const std::string& last_token, const nlohmann::detail::exception& ex) noexcept
+	{
+		LOGF_ERROR("%s", ex.what());
+		return dom.parse_error(position, last_token, ex);
+	}
+};
+
+bool OFS::io::ParseFunscript(const char* text, size_t size, std::vector<FunscriptAction>& actions, nlohmann::json& json) noexcept
+{
+	OFS_BENCHMARK(__FUNCTION__);
+	actions.clear();
+	// roughly 20 bytes per action {"at":123456,"pos":50},
+	actions.reserve(size / 20);
+
+	json = nlohmann::json();
+	FunscriptSaxHandler handler(json, actions);
+	bool success = nlohmann::json::sax_parse(text, text + size, &handler, nlohmann::json::input_format_t::json, true, true);
+	if (!success || !json.is_object()) {
+		actions.clear();
+		return false;
+	}
+
+	if (handler.needsFixup) {
+		// same result as inserting everything into a std::set
+		// the first action for every timestamp wins
+		std::stable_sort(actions.begin(), actions.end());
+		actions.erase(std::unique(actions.begin(), actions.end(),
+			[](auto a, auto b) { return a.at == b.at; }), actions.end());
+	}
+	actions.shrink_to_fit();
+	return true;
+}
+
+bool OFS::io::LoadFunscript(const std::string& path, std::vector<FunscriptAction>& actions, nlohmann::json& json) noexcept
+{
+	auto handle = Util::OpenFile(path.c_str(), "rb", path.size());
+	if (handle == nullptr) {
+		LOGF_ERROR("Failed to load funscript: \"%s\"", path.c_str());
+		return false;
+	}
+	std::vector<char> buffer(SDL_RWsize(handle));
+	size_t read = SDL_RWread(handle, buffer.data(), sizeof(char), buffer.size());
+	SDL_RWclose(handle);
+	if (read == 0) return false;
+
+	return ParseFunscript(buffer.data(), read, actions, json);
+}
+
+// collects writes and hands them to SDL_RWwrite in big chunks
+class BufferedWriter
+{
+	SDL_RWops* handle;
+	char buffer[64 * 1024];
+	size_t used = 0;
+public:
+	bool failed = false;
+
+	BufferedWriter(SDL_RWops* handle) noexcept : handle(handle) {}
+
+	inline void Flush() noexcept
+	{
+		if (used > 0 && SDL_RWwrite(handle, buffer, sizeof(char), used) != used) {
+			failed = true;
+		}
+		used = 0;
+	}
+
+	inline void Write(const char* str, size_t size) noexcept
+	{
+		if (used + size > sizeof(buffer)) {
+			Flush();
+			if (size > sizeof(buffer)) {
+				if (SDL_RWwrite(handle, str, sizeof(char), size) != size) failed = true;
+				return;
+			}
+		}
+		std::memcpy(buffer + used, str, size);
+		used += size;
+	}
+
+	inline void Write(const char* str) noexcept { Write(str, std::strlen(str)); }
+
+	inline void WriteInt(int32_t value) noexcept
+	{
+		char digits[12];
+		char* end = digits + sizeof(digits);
+		char* ptr = end;
+		uint32_t abs = value < 0 ? 0u - (uint32_t)value : (uint32_t)value;
+		do {
+			*--ptr = '0' + (abs % 10);
+			abs /= 10;
+		} while (abs != 0);
+		if (value < 0) *--ptr = '-';
+		Write(ptr, end - ptr);
+	}
+};
+
+bool OFS::io::WriteFunscript(const std::string& path, const std::vector<FunscriptAction>& actions, const nlohmann::json& json, bool pretty) noexcept
+{
+	OFS_BENCHMARK(__FUNCTION__);
+	FUN_ASSERT(json.is_object() && !json.contains("actions"), "expected a json object without actions");
+	const std::string tmpPath = path + ".tmp";
+	auto handle = Util::OpenFile(tmpPath.c_str(), "wb", tmpPath.size());
+	if (handle == nullptr) {
+		LOGF_ERROR("Failed to save: \"%s\"\n%s", path.c_str(), SDL_GetError());
+		return false;
+	}
+
+	// nlohmann orders the keys, so everything sorting in front of "actions"
+	// ("OpenFunscripter" for example) has to be written before the actions
+	nlohmann::json head = nlohmann::json::object();
+	nlohmann::json tail = nlohmann::json::object();
+	for (auto it = json.begin(); it != json.end(); ++it) {
+		(it.key() < "actions" ? head : tail)[it.key()] = it.value();
+	}
+
+	auto writer = std::make_unique<BufferedWriter>(handle);
+	if (head.empty()) {
+		writer->Write(pretty ? "{\n    \"actions\": [" : "{\"actions\":[");
+	}
+	else {
+		// without the closing brace
+		auto headText = head.dump(pretty ? 4 : -1, ' ');
+		writer->Write(headText.data(), headText.size() - (pretty ? 2 : 1));
+		writer->Write(pretty ? ",\n    \"actions\": [" : ",\"actions\":[");
+	}
+	bool first = true;
+	for (auto action : actions) {
+		// a little validation just in case
+		if (action.at < 0)
+			continue;
+
+		if (!first) writer->Write(",");
+		first = false;
+		// same layout nlohmann::json uses
+		writer->Write(pretty ? "\n        {\n            \"at\": " : "{\"at\":");
+		writer->WriteInt(action.at);
+		writer->Write(pretty ? ",\n            \"pos\": " : ",\"pos\":");
+		writer->WriteInt(Util::Clamp<int32_t>(action.pos, 0, 100));
+		writer->Write(pretty ? "\n        }" : "}");
+	}
+	writer->Write(pretty && !first ? "\n    ]" : "]");
+
+	// the remaining fields get dumped once & appended without the opening brace
+	auto rest = tail.dump(pretty ? 4 : -1, ' ');
+	if (tail.empty()) {
+		writer->Write(pretty ? "\n}" : "}");
+	}
+	else {
+		writer->Write(",");
+		writer->Write(rest.data() + 1, rest.size() - 1);
+	}
+	writer->Flush();
+	bool failed = writer->failed;
+	SDL_RWclose(handle);
+
+	std::error_code ec;
+	auto finalPath = Util::PathFromString(path);
+	auto tmpFilePath = Util::PathFromString(tmpPath);
+	if (failed) {
+		LOGF_ERROR("Failed to save: \"%s\"\n%s", path.c_str(), SDL_GetError());
+		std::filesystem::remove(tmpFilePath, ec);
+		return false;
+	}
+	std::filesystem::rename(tmpFilePath, finalPath, ec);
+	if (ec) {
+		LOGF_ERROR("Failed to save: \"%s\"\n%s", path.c_str(), ec.message().c_str());
+		std::filesystem::remove(tmpFilePath, ec);
+		return false;
+	}
+	return true;
+}
+
+bool OFS::io::FunscriptCacheEnabled = false;
+std::string OFS::io::FunscriptCacheDir;
+
+struct FunscriptCacheHeader
+{
+	char magic[4] = { 'O', 'F', 'S', 'C' };
+	uint32_t version = 1;
+	uint64_t sourceSize = 0;
+	int64_t sourceMtime = 0;
+	uint64_t checksum = 0;
+	uint64_t actionCount = 0;
+	uint64_t jsonSize = 0;
+	// followed by actionCount * FunscriptAction and jsonSize bytes of json text
+};
+
+static std::string cacheDir() noexcept
+{
+	return OFS::io::FunscriptCacheDir.empty() ? Util::Prefpath("cache") : OFS::io::FunscriptCacheDir;
+}
+
+static std::string cachePath(const std::string& path) noexcept
+{
+	char name[32];
+	stbsp_snprintf(name, sizeof(name), "%016llx.ofscache", (unsigned long long)Util::Checksum(path.data(), path.size()));
+	return (Util::PathFromString(cacheDir()) / name).u8string();
+}
+
+bool OFS::io::LoadFunscriptCache(const std::string& path, std::vector<FunscriptAction>& actions, nlohmann::json& json) noexcept
+{
+	OFS_BENCHMARK(__FUNCTION__);
+	FunscriptCacheHeader expected;
+	if (!Util::FileStat(path, expected.sourceSize, expected.sourceMtime)) return false;
+
+	OFS_MappedFile file;
+	if (!file.Open(cachePath(path)) || file.Size() < sizeof(FunscriptCacheHeader)) return false;
+
+	FunscriptCacheHeader header;
+	std::memcpy(&header, file.Data(), sizeof(header));
+	if (std::memcmp(header.magic, expected.magic, sizeof(header.magic)) != 0
+		|| header.version != expected.version
+		|| header.sourceSize != expected.sourceSize
+		|| header.sourceMtime != expected.sourceMtime
+		|| header.actionCount > file.Size() / sizeof(FunscriptAction)
+		|| file.Size() != sizeof(header) + header.actionCount * sizeof(FunscriptAction) + header.jsonSize) {
+		return false;
+	}
+
+	const uint8_t* actionData = file.Data() + sizeof(header);
+	const size_t actionBytes = header.actionCount * sizeof(FunscriptAction);
+	const char* jsonText = (const char*)(actionData + actionBytes);
+	if (Util::Checksum(jsonText, header.jsonSize, Util::Checksum(actionData, actionBytes)) != header.checksum) {
+		LOGF_WARN("Funscript cache for \"%s\" is corrupt.", path.c_str());
+		return false;
+	}
+
+	json = nlohmann::json::parse(jsonText, jsonText + header.jsonSize, nullptr, false);
+	if (!json.is_object()) return false;
+
+	actions.resize(header.actionCount);
+	std::memcpy(actions.data(), actionData, actionBytes);
+	return true;
+}
+
+void OFS::io::WriteFunscriptCache(const std::string& path, const std::vector<FunscriptAction>& actions, const nlohmann::json& json) noexcept
+{
+	OFS_BENCHMARK(__FUNCTION__);
+	FunscriptCacheHeader header;
+	if (!Util::FileStat(path, header.sourceSize, header.sourceMtime)) return;
+
+	// the cache has to contain exactly what ParseFunscript would return for the file
+	// which is the case for everything coming from ParseFunscript & WriteFunscript
+	// but it doesn't hurt to check
+	bool isNormalized = true;
+	for (size_t i = 0; i < actions.size() && isNormalized; i++) {
+		auto action = actions[i];
+		isNormalized = action.at >= 0 && action.pos >= 0 && action.pos <= 100 && action.flags == 0 && action.tag == 0
+			&& (i == 0 || action.at > actions[i - 1].at);
+	}
+	std::vector<FunscriptAction> normalized;
+	const std::vector<FunscriptAction>* cached = &actions;
+	if (!isNormalized) {
+		normalized.reserve(actions.size());
+		for (auto action : actions) {
+			if (action.at < 0) continue;
+			if (!normalized.empty() && normalized.back().at == action.at) continue;
+			normalized.emplace_back(action.at, Util::Clamp<int32_t>(action.pos, 0, 100));
+		}
+		cached = &normalized;
+	}
+
+	auto jsonText = json.dump();
+	const size_t actionBytes = cached->size() * sizeof(FunscriptAction);
+	header.actionCount = cached->size();
+	header.jsonSize = jsonText.size();
+	header.checksum = Util::Checksum(jsonText.data(), jsonText.size(), Util::Checksum(cached->data(), actionBytes));
+
+	if (!Util::CreateDirectories(Util::PathFromString(cacheDir()))) return;
+	auto cacheFile = cachePath(path);
+	auto tmpFile = cacheFile + ".tmp";
+	auto handle = Util::OpenFile(tmpFile.c_str(), "wb", tmpFile.size());
+	if (handle == nullptr) {
+		LOGF_ERROR("Failed to write funscript cache: \"%s\"\n%s", cacheFile.c_str(), SDL_GetError());
+		return;
+	}
+	bool failed = SDL_RWwrite(handle, &header, sizeof(header), 1) != 1;
+	if (actionBytes > 0) failed = failed || SDL_RWwrite(handle, cached->data(), actionBytes, 1) != 1;
+	if (header.jsonSize > 0) failed = failed || SDL_RWwrite(handle, jsonText.data(), header.jsonSize, 1) != 1;
+	SDL_RWclose(handle);
+
+	std::error_code ec;
+	if (!failed) {
+		std::filesystem::rename(Util::PathFromString(tmpFile), Util::PathFromString(cacheFile), ec);
+	}
+	if (failed || ec) {
+		LOGF_ERROR("Failed to write funscript cache: \"%s\"", cacheFile.c_str());
+		std::filesystem::remove(Util::PathFromString(tmpFile), ec);
+	}
+}
+
+bool OFS::io::LoadFunscriptCached(const std::string& path, std::vector<FunscriptAction>& actions, nlohmann::json& json) noexcept
+{
+	if (LoadFunscriptCache(path, actions, json)) {
+		return true;
+	}
+	if (!LoadFunscript(path, actions, json)) {
+		return false;
+	}
+	WriteFunscriptCache(path, actions, json);
+	return true;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "nlohmann/json.hpp"
+#include "FunscriptAction.h"
+
+#include <vector>
+#include <string>
+
+// funscript reading & writing without building a json object for every single action
+namespace OFS
+{
+	namespace io
+	{
+		// the actions end up sorted by timestamp without duplicate timestamps and without negative timestamps
+		// all other top-level fields end up in json
+		bool ParseFunscript(const char* text, size_t size, std::vector<FunscriptAction>& actions, nlohmann::json& json) noexcept;
+		bool LoadFunscript(const std::string& path, std::vector<FunscriptAction>& actions, nlohmann::json& json) noexcept;
+
+		// writes the actions followed by all other fields from json
+		// the file gets written to "<path>.tmp" first and is then renamed to path
+		// a crash during saving can't corrupt an existing script this way
+		bool WriteFunscript(const std::string& path, const std::vector<FunscriptAction>& actions, const nlohmann::json& json, bool pretty = false) noexcept;
+
+		// binary cache of parsed funscripts in the pref dir
+		// the funscript stays the source of truth, a cache entry is only used
+		// while the size & modification time of the funscript match
+		extern bool FunscriptCacheEnabled;
+		// empty means "<prefpath>/cache"
+		extern std::string FunscriptCacheDir;
+
+		bool LoadFunscriptCache(const std::string& path, std::vector<FunscriptAction>& actions, nlohmann::json& json) noexcept;
+		void WriteFunscriptCache(const std::string& path, const std::vector<FunscriptAction>& actions, const nlohmann::json& json) noexcept;
+		// tries the cache first and (re)builds it when it's missing or stale
+		bool LoadFunscriptCached(const std::string& path, std::vector<FunscriptAction>& actions, nlohmann::json& json) noexcept;
+	}
+}
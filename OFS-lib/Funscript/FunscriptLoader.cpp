@@ -0,0 +1,57 @@
+#include "FunscriptLoader.h"
+#include "EventSystem.h"
+#include "OFS_Profiling.h"
+
+#include "SDL_thread.h"
+#include "SDL_cpuinfo.h"
+
+#include <algorithm>
+
+struct LoaderThreadData {
+	std::shared_ptr<FunscriptLoader::Job> job;
+};
+
+static int loaderThread(void* user) noexcept
+{
+	OFS_BENCHMARK("FunscriptLoaderThread");
+	auto data = static_cast<LoaderThreadData*>(user);
+	auto& job = *data->job;
+
+	int32_t idx;
+	while ((idx = job.next.fetch_add(1)) < job.Total()) {
+		auto& result = job.results[idx];
+		result.success = OFS::io::FunscriptCacheEnabled
+			? OFS::io::LoadFunscriptCached(result.path, result.actions, result.json)
+			: OFS::io::LoadFunscript(result.path, result.actions, result.json);
+		job.done.fetch_add(1);
+	}
+
+	if (job.workers.fetch_sub(1) == 1) {
+		// last one out hands the results to the main thread
+		EventSystem::SingleShot([finished = std::move(data->job)](void*) {
+			finished->callback(finished->results);
+		}, nullptr);
+	}
+	delete data;
+	return 0;
+}
+
+std::shared_ptr<FunscriptLoader::Job> FunscriptLoader::Load(const std::vector<std::string>& paths, Callback&& callback) noexcept
+{
+	auto job = std::make_shared<Job>();
+	job->callback = std::move(callback);
+	job->results.resize(paths.size());
+	for (size_t i = 0; i < paths.size(); i++) {
+		job->results[i].path = paths[i];
+	}
+
+	int32_t workerCount = std::max(1, std::min<int32_t>(paths.size(), SDL_GetCPUCount()));
+	job->workers = workerCount;
+	for (int32_t i = 0; i < workerCount; i++) {
+		auto data = new LoaderThreadData();
+		data->job = job;
+		auto handle = SDL_CreateThread(loaderThread, "FunscriptLoaderThread", data);
+		SDL_DetachThread(handle);
+	}
+	return job;
+}
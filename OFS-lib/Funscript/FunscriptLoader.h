@@ -0,0 +1,38 @@
+#pragma once
+
+#include "FunscriptIO.h"
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <atomic>
+#include <functional>
+
+// parses funscripts in parallel on worker threads
+// the results get handed back to the main thread through EventSystem::SingleShot
+class FunscriptLoader
+{
+public:
+	struct Result {
+		std::string path;
+		bool success = false;
+		std::vector<FunscriptAction> actions;
+		nlohmann::json json;
+	};
+	using Callback = std::function<void(std::vector<Result>& results)>;
+
+	struct Job {
+		std::vector<Result> results;
+		Callback callback;
+		std::atomic<int32_t> next = 0;
+		std::atomic<int32_t> done = 0;
+		std::atomic<int32_t> workers = 0;
+
+		inline int32_t Total() const noexcept { return results.size(); }
+		inline int32_t Done() const noexcept { return done.load(); }
+	};
+
+	// the callback gets called on the main thread once all scripts are parsed
+	// the returned job can be used to display progress
+	static std::shared_ptr<Job> Load(const std::vector<std::string>& paths, Callback&& callback) noexcept;
+};
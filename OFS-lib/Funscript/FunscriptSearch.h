@@ -0,0 +1,92 @@
+#pragma once
+
+#include "FunscriptAction.h"
+
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+
+// binary search helpers for action vectors
+// all of them expect the actions to be sorted by FunscriptAction::at
+// which is an invariant Funscript maintains for data.Actions
+namespace OFS
+{
+	namespace search
+	{
+		// first action with at >= timeMs
+		template<typename It>
+		inline It LowerBound(It begin, It end, int32_t timeMs) noexcept
+		{
+			return std::lower_bound(begin, end, timeMs,
+				[](const FunscriptAction& action, int32_t time) { return action.at < time; });
+		}
+
+		// first action with at > timeMs
+		template<typename It>
+		inline It UpperBound(It begin, It end, int32_t timeMs) noexcept
+		{
+			return std::upper_bound(begin, end, timeMs,
+				[](int32_t time, const FunscriptAction& action) { return time < action.at; });
+		}
+
+		// first action which compares equal (at & pos) or end
+		template<typename It>
+		inline It Exact(It begin, It end, FunscriptAction action) noexcept
+		{
+			for (auto it = LowerBound(begin, end, action.at); it != end && it->at == action.at; ++it) {
+				if (*it == action) return it;
+			}
+			return end;
+		}
+
+		// first action with at > timeMs or end
+		template<typename It>
+		inline It Next(It begin, It end, int32_t timeMs) noexcept
+		{
+			return UpperBound(begin, end, timeMs);
+		}
+
+		// last action with at < timeMs or end
+		template<typename It>
+		inline It Previous(It begin, It end, int32_t timeMs) noexcept
+		{
+			auto it = LowerBound(begin, end, timeMs);
+			return it != begin ? it - 1 : end;
+		}
+
+		// closest action within the error margin or end
+		// matches the behaviour of the old linear search which only looked maxErrorMs/2 ahead
+		// and preferred the later action when two actions had the same distance
+		template<typename It>
+		inline It Closest(It begin, It end, int32_t timeMs, uint32_t maxErrorMs) noexcept
+		{
+			const int64_t maxAhead = (int64_t)timeMs + (maxErrorMs / 2);
+			auto upper = UpperBound(begin, end, timeMs);
+			auto best = end;
+			int64_t bestError = 0;
+
+			if (upper != begin) {
+				auto behind = upper - 1; // last one of equal timestamps
+				int64_t error = (int64_t)timeMs - behind->at;
+				if (error <= maxErrorMs) {
+					best = behind;
+					bestError = error;
+				}
+			}
+			if (upper != end && upper->at <= maxAhead) {
+				int64_t error = (int64_t)upper->at - timeMs;
+				if (error <= maxErrorMs && (best == end || error <= bestError)) {
+					// the linear search kept the last one of equal timestamps
+					best = UpperBound(upper, end, upper->at) - 1;
+				}
+			}
+			return best;
+		}
+
+		inline bool IsSorted(const std::vector<FunscriptAction>& actions) noexcept
+		{
+			return std::is_sorted(actions.begin(), actions.end());
+		}
+	}
+}
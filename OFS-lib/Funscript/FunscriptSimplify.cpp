@@ -0,0 +1,247 @@
+#include "FunscriptSimplify.h"
+#include "OFS_Util.h"
+
+#include "SDL_thread.h"
+#include "SDL_atomic.h"
+#include "SDL_cpuinfo.h"
+
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+// a segment between two kept points which still has to be split
+struct Segment {
+	int32_t start;
+	int32_t end;
+	// importance of the split which created this segment
+	float parentImportance;
+};
+
+// points smaller than this are never worth a thread
+static constexpr int32_t MinParallelSegment = 4096;
+// bigger position ranges don't get a PosIndex
+static constexpr int32_t MaxIndexedPositions = 1024;
+
+// positions are integers in a small range. for a fixed pos the distance to a line
+// is linear in at, so the furthest point with that pos is either the first or the last one
+// inside the segment. the index turns the scan over a segment into two binary searches per pos.
+// without it real scripts degrade to O(n^2) since every stroke reaches the same peak
+// and the first of many equally distant peaks is always right next to the segment start.
+struct PosIndex {
+	// segments shorter than this are cheaper to scan
+	int32_t minSegment = std::numeric_limits<int32_t>::max();
+	// ascending point indices for every pos which is used
+	std::vector<std::vector<int32_t>> points;
+};
+
+struct SimplifyContext {
+	const FunscriptAction* points;
+	float* importance;
+	const PosIndex* index;
+};
+
+static void BuildPosIndex(const std::vector<FunscriptAction>& points, PosIndex& index) noexcept
+{
+	auto [minIt, maxIt] = std::minmax_element(points.begin(), points.end(),
+		[](auto a, auto b) { return a.pos < b.pos; });
+	const int32_t minPos = minIt->pos;
+	const int32_t posCount = maxIt->pos - minPos + 1;
+	if (posCount > MaxIndexedPositions) return;
+
+	index.points.resize(posCount);
+	for (int32_t i = 0, size = points.size(); i < size; i++) {
+		index.points[points[i].pos - minPos].push_back(i);
+	}
+	index.points.erase(std::remove_if(index.points.begin(), index.points.end(),
+		[](auto& indices) { return indices.empty(); }), index.points.end());
+
+	int32_t log2Count = 1;
+	while ((1 << log2Count) < (int32_t)points.size()) log2Count++;
+	index.minSegment = 2 * index.points.size() * log2Count;
+}
+
+// returns the index of the point furthest away from the line start -> end or -1
+// the distance of that point ends up in maxDistance
+// ties go to the point with the lowest index regardless of how the point was found
+static int32_t FarthestPoint(const SimplifyContext& ctx, int32_t start, int32_t end, float& maxDistance) noexcept
+{
+	const auto points = ctx.points;
+	const auto lineStart = points[start];
+	const auto lineEnd = points[end];
+	const double dx = lineEnd.at - lineStart.at;
+	const double dy = lineEnd.pos - lineStart.pos;
+	const double mag = std::sqrt(dx * dx + dy * dy);
+
+	int32_t maxIdx = -1;
+	double maxValue = 0.0;
+	// |cross(pv, line)| is proportional to the perpendicular distance
+	// so the division can wait until the furthest point is known
+	// if start & end are the same point the plain distance is used
+	auto consider = [&](int32_t i) noexcept {
+		double pvx = points[i].at - lineStart.at;
+		double pvy = points[i].pos - lineStart.pos;
+		double value = mag > 0.0 ? std::abs(pvx * dy - pvy * dx) : pvx * pvx + pvy * pvy;
+		if (value > maxValue || (value == maxValue && value > 0.0 && i < maxIdx)) {
+			maxValue = value;
+			maxIdx = i;
+		}
+	};
+
+	if (end - start > ctx.index->minSegment) {
+		for (auto& indices : ctx.index->points) {
+			auto first = std::upper_bound(indices.begin(), indices.end(), start);
+			auto last = std::lower_bound(first, indices.end(), end);
+			if (first == last) continue;
+			consider(*first);
+			consider(*(last - 1));
+		}
+	}
+	else {
+		for (int32_t i = start + 1; i < end; i++) consider(i);
+	}
+	maxDistance = mag > 0.0 ? maxValue / mag : std::sqrt(maxValue);
+	return maxIdx;
+}
+
+// splits segment at its furthest point & appends the two halves
+// a point only survives epsilon if every split above it survives as well
+// which is why its importance is capped by the importance of the parent split
+static void SplitSegment(const SimplifyContext& ctx, Segment segment, std::vector<Segment>& out) noexcept
+{
+	if (segment.end - segment.start < 2) return;
+	float maxDistance;
+	int32_t maxIdx = FarthestPoint(ctx, segment.start, segment.end, maxDistance);
+	if (maxIdx < 0) return; // everything in between lies on the line
+	float value = std::min(maxDistance, segment.parentImportance);
+	ctx.importance[maxIdx] = value;
+	out.push_back({ segment.start, maxIdx, value });
+	out.push_back({ maxIdx, segment.end, value });
+}
+
+static void ProcessSegments(const SimplifyContext& ctx, std::vector<Segment>& stack) noexcept
+{
+	while (!stack.empty()) {
+		auto segment = stack.back();
+		stack.pop_back();
+		SplitSegment(ctx, segment, stack);
+	}
+}
+
+void OFS::simplify::RamerDouglasPeuckerImportance(const std::vector<FunscriptAction>& points, std::vector<float>& importance) noexcept
+{
+	const int32_t count = points.size();
+	importance.assign(count, 0.f);
+	if (count == 0) return;
+	importance.front() = std::numeric_limits<float>::max();
+	importance.back() = std::numeric_limits<float>::max();
+
+	PosIndex index;
+	BuildPosIndex(points, index);
+	SimplifyContext ctx{ points.data(), importance.data(), &index };
+
+	std::vector<Segment> segments;
+	segments.push_back({ 0, count - 1, std::numeric_limits<float>::max() });
+
+	const int32_t threadCount = std::max(SDL_GetCPUCount(), 1);
+	if (threadCount == 1 || count < 2 * MinParallelSegment) {
+		ProcessSegments(ctx, segments);
+		return;
+	}
+
+	// the halves of a split are independent of each other
+	// split breadth first until there's enough work to keep every thread busy
+	const size_t targetSegments = threadCount * 4;
+	while (segments.size() < targetSegments) {
+		std::vector<Segment> next;
+		next.reserve(segments.size() * 2);
+		bool split = false;
+		for (auto segment : segments) {
+			if (segment.end - segment.start < MinParallelSegment) {
+				next.push_back(segment);
+				continue;
+			}
+			SplitSegment(ctx, segment, next);
+			split = true;
+		}
+		segments = std::move(next);
+		if (!split) break;
+	}
+	// biggest first so that the last thread to finish isn't stuck with a huge segment
+	std::sort(segments.begin(), segments.end(), [](auto& a, auto& b) {
+		return (a.end - a.start) > (b.end - b.start);
+	});
+
+	struct WorkerData {
+		const SimplifyContext* ctx;
+		const std::vector<Segment>* segments;
+		SDL_atomic_t next;
+	};
+	WorkerData data{ &ctx, &segments };
+	SDL_AtomicSet(&data.next, 0);
+
+	auto worker = [](void* user) -> int {
+		auto& data = *(WorkerData*)user;
+		std::vector<Segment> stack;
+		int32_t idx;
+		while ((idx = SDL_AtomicAdd(&data.next, 1)) < (int32_t)data.segments->size()) {
+			// segments don't overlap so every thread writes to its own part of importance
+			stack.push_back((*data.segments)[idx]);
+			ProcessSegments(*data.ctx, stack);
+		}
+		return 0;
+	};
+
+	std::vector<SDL_Thread*> threads;
+	threads.reserve(threadCount - 1);
+	for (int32_t i = 0; i < threadCount - 1; i++) {
+		threads.push_back(SDL_CreateThread(worker, "RamerDouglasPeucker", &data));
+	}
+	// the calling thread helps out
+	worker(&data);
+	for (auto thread : threads) {
+		SDL_WaitThread(thread, nullptr);
+	}
+}
+
+void OFS::simplify::FilterByImportance(const std::vector<FunscriptAction>& points, const std::vector<float>& importance, float epsilon, std::vector<FunscriptAction>& output) noexcept
+{
+	FUN_ASSERT(points.size() == importance.size(), "importance doesn't belong to points");
+	for (size_t i = 0, size = std::min(points.size(), importance.size()); i < size; i++) {
+		if (importance[i] > epsilon) output.push_back(points[i]);
+	}
+}
+
+void OFS::simplify::RamerDouglasPeucker(const std::vector<FunscriptAction>& points, float epsilon, std::vector<FunscriptAction>& output) noexcept
+{
+	std::vector<float> importance;
+	RamerDouglasPeuckerImportance(points, importance);
+	FilterByImportance(points, importance, epsilon, output);
+}
+
+void OFS::simplify::RemoveRedundantActions(const std::vector<FunscriptAction>& actions, std::vector<FunscriptAction>& output) noexcept
+{
+	if (actions.size() < 3) {
+		output.insert(output.end(), actions.begin(), actions.end());
+		return;
+	}
+
+	output.reserve(output.size() + actions.size());
+	output.emplace_back(actions.front());
+	for (int i = 1; i < actions.size() - 1; i++) {
+		auto previous = output.back();
+		auto current = actions[i];
+		auto next = actions[i + 1];
+
+		float speedPreviousToNext = std::abs(previous.pos - next.pos) / (float)(next.at - previous.at);
+
+		float speedPreviousToCurrent = std::abs(previous.pos - current.pos) / (float)(current.at - previous.at);
+		float speedCurrentToNext = std::abs(current.pos - next.pos) / (float)(next.at - current.at);
+
+		float avgSpeedSegments = (speedPreviousToCurrent + speedCurrentToNext) / 2.f;
+
+		if (std::abs(speedPreviousToNext - avgSpeedSegments) > (speedPreviousToNext * 0.005)) {
+			output.emplace_back(current);
+		}
+	}
+	output.emplace_back(actions.back());
+}
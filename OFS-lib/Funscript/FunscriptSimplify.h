@@ -0,0 +1,28 @@
+#pragma once
+
+#include "FunscriptAction.h"
+
+#include <vector>
+
+// script simplification which doesn't need the app
+// used by the special functions, Funscript::saveMinium and the cli
+namespace OFS
+{
+	namespace simplify
+	{
+		// ramer-douglas-peucker importance of every point, points have to be ordered by timestamp
+		// a point is part of the simplification for epsilon when importance > epsilon
+		// the first & last point are always kept. big inputs are split across threads
+		void RamerDouglasPeuckerImportance(const std::vector<FunscriptAction>& points, std::vector<float>& importance) noexcept;
+		// O(n) threshold filter, the result gets appended to output
+		void FilterByImportance(const std::vector<FunscriptAction>& points, const std::vector<float>& importance, float epsilon, std::vector<FunscriptAction>& output) noexcept;
+
+		// computes the importance & filters it in one go, the result gets appended to output
+		// use the two functions above when simplifying the same points with different epsilons
+		void RamerDouglasPeucker(const std::vector<FunscriptAction>& points, float epsilon, std::vector<FunscriptAction>& output) noexcept;
+
+		// drops actions which don't change the speed noticeably
+		// this is what gets written by Funscript::saveMinium
+		void RemoveRedundantActions(const std::vector<FunscriptAction>& actions, std::vector<FunscriptAction>& output) noexcept;
+	}
+}
@@ -0,0 +1,197 @@
+#include "FunscriptSpline.h"
+#include "OFS_Profiling.h"
+
+#include <algorithm>
+#include <xmmintrin.h>
+#include <emmintrin.h>
+
+FunscriptSpline::Segment FunscriptSpline::ComputeSegment(const std::vector<FunscriptAction>& actions, int32_t i) noexcept
+{
+	const int32_t last = (int32_t)actions.size() - 1;
+	auto& a0 = actions[std::clamp(i - 1, 0, last)];
+	auto& a1 = actions[std::clamp(i, 0, last)];
+	auto& a2 = actions[std::clamp(i + 1, 0, last)];
+	auto& a3 = actions[std::clamp(i + 2, 0, last)];
+
+	float p0 = a0.pos / 100.f;
+	float p1 = a1.pos / 100.f;
+	float p2 = a2.pos / 100.f;
+	float p3 = a3.pos / 100.f;
+
+	// glm::catmullRom expanded into powers of s
+	Segment seg;
+	int32_t duration = a2.at - a1.at;
+	seg.invDuration = duration != 0 ? 1.f / duration : 0.f;
+	seg.c0 = p1;
+	seg.c1 = 0.5f * (p2 - p0);
+	seg.c2 = 0.5f * (2.f * p0 - 5.f * p1 + 4.f * p2 - p3);
+	seg.c3 = 0.5f * (-p0 + 3.f * p1 - 3.f * p2 + p3);
+	return seg;
+}
+
+void FunscriptSpline::Update(const std::vector<FunscriptAction>& actions) noexcept
+{
+	OFS_BENCHMARK(__FUNCTION__);
+	const size_t oldSize = nodes.size();
+	const size_t newSize = actions.size();
+	const size_t minSize = std::min(oldSize, newSize);
+
+	size_t prefix = 0;
+	while (prefix < minSize && nodes[prefix] == actions[prefix]) {
+		prefix++;
+	}
+	if (prefix == oldSize && prefix == newSize) {
+		return;
+	}
+	size_t suffix = 0;
+	while (suffix < minSize - prefix && nodes[oldSize - 1 - suffix] == actions[newSize - 1 - suffix]) {
+		suffix++;
+	}
+
+	nodes.assign(actions.begin(), actions.end());
+	times.resize(newSize);
+	for (size_t i = 0; i < newSize; i++) {
+		times[i] = actions[i].at;
+	}
+	cacheIdx = 0;
+
+	if (oldSize < 2 || newSize < 2) {
+		segments.resize(newSize > 1 ? newSize - 1 : 0);
+		for (size_t i = 0; i < segments.size(); i++) {
+			segments[i] = ComputeSegment(actions, i);
+		}
+		return;
+	}
+
+	// segment i depends on the actions i-1 to i+2
+	// so everything from two segments in front of the first change
+	// up to one segment behind the last change needs to be recomputed
+	const size_t first = prefix >= 2 ? prefix - 2 : 0;
+	const size_t newEnd = std::min(newSize - 1, newSize - suffix + 1);
+	const size_t oldEnd = std::min(oldSize - 1, oldSize - suffix + 1);
+
+	segments.erase(segments.begin() + first, segments.begin() + oldEnd);
+	segments.insert(segments.begin() + first, newEnd - first, Segment{});
+	for (size_t i = first; i < newEnd; i++) {
+		segments[i] = ComputeSegment(actions, i);
+	}
+}
+
+int32_t FunscriptSpline::findSegment(float timeMs) const noexcept
+{
+	// first action after timeMs
+	auto it = std::upper_bound(times.begin(), times.end(), timeMs);
+	if (it == times.begin() || it == times.end()) {
+		return -1;
+	}
+	return (int32_t)(it - times.begin()) - 1;
+}
+
+FunscriptSpline::Segment FunscriptSpline::linearSegment(int32_t i) const noexcept
+{
+	Segment seg;
+	seg.invDuration = segments[i].invDuration;
+	seg.c0 = nodes[i].pos / 100.f;
+	seg.c1 = nodes[i + 1].pos / 100.f - seg.c0;
+	seg.c2 = 0.f;
+	seg.c3 = 0.f;
+	return seg;
+}
+
+// walks the segments with a cursor and evaluates every run of samples
+// which falls into the same segment four at a time
+// timeAt(i) returns the time of sample i, timeVec(i) the times of i to i+3
+// runEnd(i, segEnd) returns the first sample at or after segEnd
+template<typename TimeAt, typename TimeVec, typename RunEnd>
+void FunscriptSpline::sampleSorted(int32_t count, float* out, bool linear, TimeAt&& timeAt, TimeVec&& timeVec, RunEnd&& runEnd) const noexcept
+{
+	if (nodes.size() == 0) {
+		std::fill_n(out, count, 0.f);
+		return;
+	}
+	const float frontPos = nodes.front().pos / 100.f;
+	const float backPos = nodes.back().pos / 100.f;
+	if (nodes.size() == 1) {
+		std::fill_n(out, count, frontPos);
+		return;
+	}
+
+	int32_t i = 0;
+	while (i < count && timeAt(i) < times.front()) {
+		out[i++] = frontPos;
+	}
+	if (i == count) return;
+
+	size_t seg = std::max(findSegment(timeAt(i)), 0);
+	while (i < count) {
+		const float t = timeAt(i);
+		while (seg + 1 < times.size() && times[seg + 1] <= t) seg++;
+		if (seg + 1 >= times.size()) {
+			std::fill(out + i, out + count, backPos);
+			return;
+		}
+
+		// every sample in [i, end) falls into this segment
+		const int32_t end = runEnd(i, times[seg + 1]);
+
+		const Segment s = linear ? linearSegment(seg) : segments[seg];
+		const float start = times[seg];
+		const __m128 startVec = _mm_set1_ps(start);
+		const __m128 invDuration = _mm_set1_ps(s.invDuration);
+		const __m128 c0 = _mm_set1_ps(s.c0);
+		const __m128 c1 = _mm_set1_ps(s.c1);
+		const __m128 c2 = _mm_set1_ps(s.c2);
+		const __m128 c3 = _mm_set1_ps(s.c3);
+		for (; i + 4 <= end; i += 4) {
+			__m128 x = _mm_mul_ps(_mm_sub_ps(timeVec(i), startVec), invDuration);
+			__m128 y = _mm_add_ps(_mm_mul_ps(c3, x), c2);
+			y = _mm_add_ps(_mm_mul_ps(y, x), c1);
+			y = _mm_add_ps(_mm_mul_ps(y, x), c0);
+			_mm_storeu_ps(out + i, y);
+		}
+		for (; i < end; i++) {
+			out[i] = evaluate(s, start, timeAt(i));
+		}
+	}
+}
+
+void FunscriptSpline::SampleRange(float t0, float dt, int32_t count, float* out, bool linear) const noexcept
+{
+	auto timeAt = [t0, dt](int32_t i) noexcept { return t0 + dt * (float)i; };
+	if (dt < 0.f) {
+		// the segment cursor only walks forward
+		for (int32_t i = 0; i < count; i++) {
+			out[i] = sampleAt(timeAt(i), linear);
+		}
+		return;
+	}
+
+	const __m128 laneOffset = _mm_setr_ps(0.f, 1.f, 2.f, 3.f);
+	const __m128 dtVec = _mm_set1_ps(dt);
+	const __m128 t0Vec = _mm_set1_ps(t0);
+	auto timeVec = [&](int32_t i) noexcept {
+		__m128 idx = _mm_add_ps(_mm_set1_ps((float)i), laneOffset);
+		return _mm_add_ps(t0Vec, _mm_mul_ps(dtVec, idx));
+	};
+	auto runEnd = [&](int32_t i, float segEnd) noexcept {
+		if (dt == 0.f) return count;
+		// guess from the spacing and fix up the rounding
+		int32_t end = std::max((int32_t)std::min((segEnd - t0) / dt, (float)count), i + 1);
+		while (end > i + 1 && timeAt(end - 1) >= segEnd) end--;
+		while (end < count && timeAt(end) < segEnd) end++;
+		return end;
+	};
+	sampleSorted(count, out, linear, timeAt, timeVec, runEnd);
+}
+
+void FunscriptSpline::SampleTimes(const float* timesMs, int32_t count, float* out, bool linear) const noexcept
+{
+	auto timeAt = [timesMs](int32_t i) noexcept { return timesMs[i]; };
+	auto timeVec = [timesMs](int32_t i) noexcept { return _mm_loadu_ps(timesMs + i); };
+	auto runEnd = [timesMs, count](int32_t i, float segEnd) noexcept {
+		int32_t end = i + 1;
+		while (end < count && timesMs[end] < segEnd) end++;
+		return end;
+	};
+	sampleSorted(count, out, linear, timeAt, timeVec, runEnd);
+}
@@ -3,93 +3,97 @@
 #include "FunscriptAction.h"
 
 #include <vector>
-#include <map>
-#include "glm/gtx/spline.hpp"
+#include <cstdint>
 
+// catmull-rom spline through all actions of a script
+// every segment between two actions is stored as a cubic in s = (t - start) / duration
+// Update only recomputes the segments touched by an edit
 class FunscriptSpline
 {
-	std::map<int32_t, int32_t> SplineActionMap; // maps timeMs to Index in actions vector
+public:
+	// y(s) = ((c3 * s + c2) * s + c1) * s + c0
+	struct Segment {
+		float invDuration;
+		float c0, c1, c2, c3;
+	};
+private:
+	std::vector<FunscriptAction> nodes; // copy of the actions from the last update
+	std::vector<float> times; // action timestamps, contiguous for the binary search
+	std::vector<Segment> segments; // segments[i] goes from nodes[i] to nodes[i + 1]
 	int32_t cacheIdx = 0;
 
-	inline auto catmull_rom_spline(const std::vector<FunscriptAction>& actions, int32_t i, float ms) const noexcept
-	{
-		int i0 = glm::clamp<int>(i - 1, 0, actions.size() - 1);
-		int i1 = glm::clamp<int>(i, 0, actions.size() - 1);
-		int i2 = glm::clamp<int>(i + 1, 0, actions.size() - 1);
-		int i3 = glm::clamp<int>(i + 2, 0, actions.size() - 1);
+	// the segment which contains timeMs or -1 if timeMs is outside of the spline
+	int32_t findSegment(float timeMs) const noexcept;
 
-		glm::vec2 v0(actions[i0].at / (float)actions.back().at, actions[i0].pos / 100.f);
-		glm::vec2 v1(actions[i1].at / (float)actions.back().at, actions[i1].pos / 100.f);
-		glm::vec2 v2(actions[i2].at / (float)actions.back().at, actions[i2].pos / 100.f);
-		glm::vec2 v3(actions[i3].at / (float)actions.back().at, actions[i3].pos / 100.f);
+	// same coefficients for a straight line between the two actions
+	Segment linearSegment(int32_t i) const noexcept;
 
-		float t = ms;
-		t -= actions[i1].at;
-		t /= actions[i2].at - actions[i1].at;
+	template<typename TimeAt, typename TimeVec, typename RunEnd>
+	void sampleSorted(int32_t count, float* out, bool linear, TimeAt&& timeAt, TimeVec&& timeVec, RunEnd&& runEnd) const noexcept;
 
-		return glm::catmullRom(v0, v1, v2, v3, t).y;
+	inline float sampleAt(float timeMs, bool linear) const noexcept
+	{
+		int32_t idx = findSegment(timeMs);
+		if (idx < 0) {
+			return timeMs < times.front() ? nodes.front().pos / 100.f : nodes.back().pos / 100.f;
+		}
+		return evaluate(linear ? linearSegment(idx) : segments[idx], times[idx], timeMs);
 	}
 
-public:
-
-	inline void Update(const std::vector<FunscriptAction>& actions) noexcept
+	static inline float evaluate(const Segment& seg, float start, float timeMs) noexcept
 	{
-		SplineActionMap.clear();
-		for (int i = 0; i < actions.size(); i++)
-		{
-			SplineActionMap.insert(std::make_pair(actions[i].at, i));
-		}
+		float s = (timeMs - start) * seg.invDuration;
+		return ((seg.c3 * s + seg.c2) * s + seg.c1) * s + seg.c0;
 	}
 
-	inline float Sample(const std::vector<FunscriptAction>& actions, float timeMs) noexcept 
+public:
+	static Segment ComputeSegment(const std::vector<FunscriptAction>& actions, int32_t i) noexcept;
+
+	void Update(const std::vector<FunscriptAction>& actions) noexcept;
+
+	inline float Sample(float timeMs) noexcept
 	{
-		if (actions.size() == 0) { return 0.f; }
-		else if (actions.size() == 1) { return actions.front().pos / 100.f; }
-		else if (cacheIdx + 1 >= actions.size()) { cacheIdx = 0; }
+		if (nodes.size() == 0) { return 0.f; }
+		else if (nodes.size() == 1) { return nodes.front().pos / 100.f; }
+		else if (cacheIdx + 1 >= nodes.size()) { cacheIdx = 0; }
 
-		if (actions[cacheIdx].at <= timeMs && actions[cacheIdx + 1].at >= timeMs)
-		{
+		if (times[cacheIdx] <= timeMs && times[cacheIdx + 1] > timeMs) {
 			// cache hit!
-			return catmull_rom_spline(actions, cacheIdx, timeMs);
+			return evaluate(segments[cacheIdx], times[cacheIdx], timeMs);
 		}
-		else if (cacheIdx + 2 < actions.size() && actions[cacheIdx+1].at <= timeMs && actions[cacheIdx+2].at >= timeMs)
-		{
+		else if (cacheIdx + 2 < times.size() && times[cacheIdx + 1] <= timeMs && times[cacheIdx + 2] > timeMs) {
 			// sort of a cache hit
 			cacheIdx += 1;
-			return catmull_rom_spline(actions, cacheIdx, timeMs);
+			return evaluate(segments[cacheIdx], times[cacheIdx], timeMs);
 		}
-		else
-		{
-			// cache miss
-			// lookup index
-			auto it = SplineActionMap.upper_bound((int32_t)timeMs);
-			if (it == SplineActionMap.end()) { 
-				return actions.back().pos / 100.f; 
-			}
-			else if (it == SplineActionMap.begin())			{
-				return actions.front().pos / 100.f;
-			}
 
-			it--;
-			// cache index
-			cacheIdx = it->second;
-			return catmull_rom_spline(actions, it->second, timeMs);
+		int32_t idx = findSegment(timeMs);
+		if (idx < 0) {
+			return timeMs < times.front() ? nodes.front().pos / 100.f : nodes.back().pos / 100.f;
 		}
-
-		return 0.f;
+		cacheIdx = idx;
+		return evaluate(segments[idx], times[idx], timeMs);
 	}
 
-	inline float SampleAtIndex(const std::vector<FunscriptAction>& actions, int32_t index, float timeMs) const noexcept
+	// batch sampling, linear interpolates straight between the actions instead of the spline
+	// fills out[i] with the value at t0 + i * dt
+	void SampleRange(float t0, float dt, int32_t count, float* out, bool linear = false) const noexcept;
+	// fills out[i] with the value at timesMs[i], timesMs has to be sorted
+	void SampleTimes(const float* timesMs, int32_t count, float* out, bool linear = false) const noexcept;
+
+	// evaluates the segment starting at index straight from the actions
+	// doesn't touch the segment table, the TCode thread uses this
+	inline static float SampleAtIndex(const std::vector<FunscriptAction>& actions, int32_t index, float timeMs) noexcept
 	{
 		if (actions.size() == 0) { return 0.f; }
 		if (index + 1 < actions.size())
 		{
 			if (actions[index].at <= timeMs && actions[index + 1].at >= timeMs)
 			{
-				return catmull_rom_spline(actions, index, timeMs);
+				return evaluate(ComputeSegment(actions, index), actions[index].at, timeMs);
 			}
 		}
 
 		return 0.f;
 	}
-};
\ No newline at end of file
+};
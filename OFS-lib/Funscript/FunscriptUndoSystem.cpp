@@ -1,8 +1,319 @@
 #include "FunscriptUndoSystem.h"
+#include "OFS_UndoSystem.h"
+
+#include <cstring>
+#include <algorithm>
+
+// unlike operator== this also compares flags & tag
+// a selection change has to end up in the delta as well
+inline static bool identical(FunscriptAction a, FunscriptAction b) noexcept
+{
+	return std::memcmp(&a, &b, sizeof(FunscriptAction)) == 0;
+}
+
+FunscriptDelta FunscriptDelta::Create(const std::vector<FunscriptAction>& from, const std::vector<FunscriptAction>& to) noexcept
+{
+	OFS_BENCHMARK(__FUNCTION__);
+	FunscriptDelta delta;
+	Run* run = nullptr;
+	size_t i = 0, j = 0;
+
+	// merge walk over both vectors, everything which isn't identical
+	// gets collected into runs of removed & inserted actions
+	while (i < from.size() || j < to.size()) {
+		if (i < from.size() && j < to.size() && identical(from[i], to[j])) {
+			i++; j++;
+			run = nullptr;
+			continue;
+		}
+
+		if (run == nullptr) {
+			run = &delta.runs.emplace_back(Run{ (int32_t)i, 0, 0 });
+		}
+
+		if (j >= to.size() || (i < from.size() && from[i].at < to[j].at)) {
+			delta.removed.emplace_back(from[i++]);
+			run->removedCount++;
+		}
+		else if (i >= from.size() || to[j].at < from[i].at) {
+			delta.inserted.emplace_back(to[j++]);
+			run->insertedCount++;
+		}
+		else {
+			// same timestamp but modified
+			delta.removed.emplace_back(from[i++]);
+			delta.inserted.emplace_back(to[j++]);
+			run->removedCount++;
+			run->insertedCount++;
+		}
+	}
+
+	delta.runs.shrink_to_fit();
+	delta.removed.shrink_to_fit();
+	delta.inserted.shrink_to_fit();
+	return delta;
+}
+
+void FunscriptDelta::Apply(const std::vector<FunscriptAction>& from, std::vector<FunscriptAction>& to) const noexcept
+{
+	to.clear();
+	to.reserve(from.size() + inserted.size() - removed.size());
+
+	auto removedIt = removed.begin();
+	auto insertedIt = inserted.begin();
+	int32_t cursor = 0;
+	for (auto& run : runs) {
+		to.insert(to.end(), from.begin() + cursor, from.begin() + run.index);
+		to.insert(to.end(), insertedIt, insertedIt + run.insertedCount);
+		removedIt += run.removedCount;
+		insertedIt += run.insertedCount;
+		cursor = run.index + run.removedCount;
+	}
+	to.insert(to.end(), from.begin() + cursor, from.end());
+}
+
+void FunscriptDelta::Revert(const std::vector<FunscriptAction>& to, std::vector<FunscriptAction>& from) const noexcept
+{
+	from.clear();
+	from.reserve(to.size() + removed.size() - inserted.size());
+
+	auto removedIt = removed.begin();
+	int32_t cursor = 0;
+	int32_t shift = 0; // difference between indices in "to" and "from"
+	for (auto& run : runs) {
+		int32_t toIndex = run.index + shift;
+		from.insert(from.end(), to.begin() + cursor, to.begin() + toIndex);
+		from.insert(from.end(), removedIt, removedIt + run.removedCount);
+		removedIt += run.removedCount;
+		cursor = toIndex + run.insertedCount;
+		shift += run.insertedCount - run.removedCount;
+	}
+	from.insert(from.end(), to.begin() + cursor, to.end());
+}
+
+inline static void writeVarint(std::vector<uint8_t>& out, uint32_t value) noexcept
+{
+	while (value >= 0x80) {
+		out.emplace_back((uint8_t)(value | 0x80));
+		value >>= 7;
+	}
+	out.emplace_back((uint8_t)value);
+}
+
+inline static uint32_t readVarint(const uint8_t*& ptr) noexcept
+{
+	uint32_t value = 0;
+	for (int shift = 0;; shift += 7) {
+		uint8_t byte = *ptr++;
+		value |= (uint32_t)(byte & 0x7F) << shift;
+		if (!(byte & 0x80)) break;
+	}
+	return value;
+}
+
+inline static uint32_t zigzag(int32_t value) noexcept { return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31); }
+inline static int32_t unzigzag(uint32_t value) noexcept { return (int32_t)(value >> 1) ^ -(int32_t)(value & 1); }
+
+// timestamps & positions are stored as the difference to the previous action
+// which usually fits into one or two bytes
+static void writeActions(std::vector<uint8_t>& out, const std::vector<FunscriptAction>& actions) noexcept
+{
+	writeVarint(out, actions.size());
+	uint32_t prevAt = 0;
+	int32_t prevPos = 0;
+	for (auto action : actions) {
+		writeVarint(out, zigzag((int32_t)((uint32_t)action.at - prevAt)));
+		writeVarint(out, zigzag(action.pos - prevPos));
+		writeVarint(out, action.flags | (action.tag << 8));
+		prevAt = action.at;
+		prevPos = action.pos;
+	}
+}
+
+static void readActions(const uint8_t*& ptr, std::vector<FunscriptAction>& actions) noexcept
+{
+	actions.resize(readVarint(ptr));
+	uint32_t prevAt = 0;
+	int32_t prevPos = 0;
+	for (auto& action : actions) {
+		action.at = (int32_t)(prevAt + (uint32_t)unzigzag(readVarint(ptr)));
+		action.pos = prevPos + unzigzag(readVarint(ptr));
+		uint32_t flagsAndTag = readVarint(ptr);
+		action.flags = flagsAndTag & 0xFF;
+		action.tag = flagsAndTag >> 8;
+		prevAt = action.at;
+		prevPos = action.pos;
+	}
+}
+
+void ScriptState::Compress() noexcept
+{
+	if (IsCompressed()) return;
+	std::vector<uint8_t> out;
+	out.reserve(16 + (delta.removed.size() + delta.inserted.size()) * 4);
+
+	writeVarint(out, delta.runs.size());
+	int32_t prevIndex = 0;
+	for (auto& run : delta.runs) {
+		writeVarint(out, zigzag(run.index - prevIndex));
+		writeVarint(out, run.removedCount);
+		writeVarint(out, run.insertedCount);
+		prevIndex = run.index;
+	}
+	writeActions(out, delta.removed);
+	writeActions(out, delta.inserted);
+	if (keyframe) {
+		writeActions(out, keyframe->Actions);
+	}
+
+	out.shrink_to_fit();
+	compressed = std::move(out);
+	delta = FunscriptDelta();
+	keyframe.reset();
+}
+
+void ScriptState::Decompress() noexcept
+{
+	if (!IsCompressed()) return;
+	const uint8_t* ptr = compressed.data();
+
+	delta.runs.resize(readVarint(ptr));
+	int32_t prevIndex = 0;
+	for (auto& run : delta.runs) {
+		run.index = prevIndex + unzigzag(readVarint(ptr));
+		run.removedCount = readVarint(ptr);
+		run.insertedCount = readVarint(ptr);
+		prevIndex = run.index;
+	}
+	readActions(ptr, delta.removed);
+	readActions(ptr, delta.inserted);
+	if (isKeyframe) {
+		keyframe = std::make_unique<Funscript::FunscriptData>();
+		readActions(ptr, keyframe->Actions);
+	}
+
+	FUN_ASSERT(ptr == compressed.data() + compressed.size(), "corrupt undo state");
+	compressed = std::vector<uint8_t>();
+}
+
+void ScriptStateStack::compress(size_t idx) noexcept
+{
+	auto& state = states[idx];
+	byteSize -= state.ByteSize();
+	state.Compress();
+	byteSize += state.ByteSize();
+}
+
+void ScriptStateStack::decompress(size_t idx) noexcept
+{
+	auto& state = states[idx];
+	byteSize -= state.ByteSize();
+	state.Decompress();
+	byteSize += state.ByteSize();
+}
+
+void ScriptStateStack::Push(int32_t type, const Funscript::FunscriptData& data) noexcept
+{
+	ScriptState state(type);
+	if (states.empty()) {
+		state.keyframe = std::make_unique<Funscript::FunscriptData>(data);
+		state.isKeyframe = true;
+	}
+	else {
+		state.delta = FunscriptDelta::Create(top.Actions, data.Actions);
+		int32_t sinceKeyframe = 0;
+		for (size_t i = states.size(); i > 0 && !states[i - 1].isKeyframe; i--) {
+			sinceKeyframe++;
+		}
+		if (sinceKeyframe + 1 >= OFS::ScriptStateKeyframeInterval) {
+			state.keyframe = std::make_unique<Funscript::FunscriptData>(data);
+			state.isKeyframe = true;
+		}
+	}
+	top.Actions = data.Actions;
+	byteSize += state.ByteSize();
+	states.emplace_back(std::move(state));
+
+	if (states.size() > OFS::UncompressedScriptStates) {
+		compress(states.size() - 1 - OFS::UncompressedScriptStates);
+	}
+}
+
+void ScriptStateStack::Pop(Funscript::FunscriptData& data) noexcept
+{
+	FUN_ASSERT(!states.empty(), "stack is empty");
+	data = std::move(top);
+	top = Funscript::FunscriptData();
+
+	if (states.size() > 1) {
+		const size_t belowIdx = states.size() - 2;
+		if (states[belowIdx].isKeyframe) {
+			const bool wasCompressed = states[belowIdx].IsCompressed();
+			decompress(belowIdx);
+			top.Actions = states[belowIdx].keyframe->Actions;
+			// top is a copy of the keyframe now, no point in keeping both around
+			if (wasCompressed) compress(belowIdx);
+		}
+		else {
+			decompress(states.size() - 1);
+			states.back().delta.Revert(data.Actions, top.Actions);
+		}
+	}
+	byteSize -= states.back().ByteSize();
+	states.pop_back();
+}
+
+void ScriptStateStack::DropBottom(size_t count) noexcept
+{
+	if (count == 0) return;
+	if (count >= states.size()) {
+		Clear();
+		return;
+	}
+
+	// the new bottom has to be a keyframe
+	auto& bottom = states[count];
+	if (!bottom.isKeyframe) {
+		// replay the deltas from the closest keyframe below
+		size_t keyIdx = count;
+		while (!states[keyIdx].isKeyframe) keyIdx--;
+		decompress(keyIdx);
+		std::vector<FunscriptAction> actions = states[keyIdx].keyframe->Actions;
+		std::vector<FunscriptAction> next;
+		for (size_t i = keyIdx + 1; i <= count; i++) {
+			decompress(i);
+			states[i].delta.Apply(actions, next);
+			std::swap(actions, next);
+		}
+
+		byteSize -= bottom.ByteSize();
+		bottom.keyframe = std::make_unique<Funscript::FunscriptData>();
+		bottom.keyframe->Actions = std::move(actions);
+		bottom.isKeyframe = true;
+		// the bottom never gets reverted
+		bottom.delta = FunscriptDelta();
+		byteSize += bottom.ByteSize();
+		if (states.size() - 1 - count >= OFS::UncompressedScriptStates) {
+			compress(count);
+		}
+	}
+
+	for (size_t i = 0; i < count; i++) {
+		byteSize -= states.front().ByteSize();
+		states.pop_front();
+	}
+}
+
+void ScriptStateStack::Clear() noexcept
+{
+	states.clear();
+	top = Funscript::FunscriptData();
+	byteSize = 0;
+}
 
 void FunscriptUndoSystem::SnapshotRedo(int32_t type) noexcept
 {
-	RedoStack.emplace_back(type, script->Data());
+	RedoStack.Push(type, script->Data());
 }
 
 void FunscriptUndoSystem::ShowUndoRedoHistory(bool* open)
@@ -12,62 +323,61 @@ void FunscriptUndoSystem::ShowUndoRedoHistory(bool* open)
 		ImGui::SetNextWindowSizeConstraints(ImVec2(200, 100), ImVec2(200, 200));
 		ImGui::Begin(UndoHistoryId, open, ImGuiWindowFlags_AlwaysVerticalScrollbar | ImGuiWindowFlags_AlwaysAutoResize);
 		ImGui::TextDisabled("Redo stack");
-		for (auto it = RedoStack.begin(); it != RedoStack.end(); it++) {
+		auto& redoStates = RedoStack.States();
+		for (size_t i = 0; i < redoStates.size(); i++) {
 			int count = 1;
-			auto copy_it = it;
-			while (++copy_it != RedoStack.end() && copy_it->type == it->type) {
-				count++;
+			while (i + 1 < redoStates.size() && redoStates[i + 1].type == redoStates[i].type) {
+				count++; i++;
 			}
-			it = copy_it - 1;
 
-			ImGui::BulletText("%s (%d)", (*it).Message().c_str(), count);
+			ImGui::BulletText("%s (%d)", redoStates[i].Message().c_str(), count);
 		}
 		ImGui::Separator();
 		ImGui::TextDisabled("Undo stack");
-		for (auto it = UndoStack.rbegin(); it != UndoStack.rend(); it++) {
+		auto& undoStates = UndoStack.States();
+		for (size_t i = undoStates.size(); i > 0; i--) {
 			int count = 1;
-			auto copy_it = it;
-			while (++copy_it != UndoStack.rend() && copy_it->type == it->type) {
-				count++;
+			while (i > 1 && undoStates[i - 2].type == undoStates[i - 1].type) {
+				count++; i--;
 			}
-			it = copy_it - 1;
 
-			ImGui::BulletText("%s (%d)", (*it).Message().c_str(), count);
+			ImGui::BulletText("%s (%d)", undoStates[i - 1].Message().c_str(), count);
 		}
+		ImGui::Separator();
+		ImGui::TextDisabled("Memory: %.2f MB", ByteSize() / (1024.f * 1024.f));
+		ImGui::TextDisabled("Budget: %d MB for all scripts", UndoSystem::MemoryBudgetMB);
 		ImGui::End();
 	}
 }
 
 void FunscriptUndoSystem::Snapshot(int32_t type, bool clearRedo) noexcept
 {
-	UndoStack.emplace_back(type, script->Data());
-
-	if (UndoStack.size() > OFS::MaxScriptStateInMemory) {
-		UndoStack.erase(UndoStack.begin()); // erase first action
-	}
+	UndoStack.Push(type, script->Data());
 
 	// redo gets cleared after every snapshot
-	if (clearRedo && !RedoStack.empty())
+	if (clearRedo && !RedoStack.Empty())
 		ClearRedo();
 }
 
 void FunscriptUndoSystem::Undo() noexcept
 {
-	if (UndoStack.empty()) return;
-	SnapshotRedo(UndoStack.back().type);
-	script->rollback(UndoStack.back().Data()); // copy data
-	UndoStack.pop_back(); // pop of the stack
+	if (UndoStack.Empty()) return;
+	SnapshotRedo(UndoStack.Back().type);
+	Funscript::FunscriptData state;
+	UndoStack.Pop(state);
+	script->rollback(std::move(state));
 }
 
 void FunscriptUndoSystem::Redo() noexcept
 {
-	if (RedoStack.empty()) return;
-	Snapshot(RedoStack.back().type, false);
-	script->rollback(RedoStack.back().Data()); // copy data
-	RedoStack.pop_back(); // pop of the stack
+	if (RedoStack.Empty()) return;
+	Snapshot(RedoStack.Back().type, false);
+	Funscript::FunscriptData state;
+	RedoStack.Pop(state);
+	script->rollback(std::move(state));
 }
 
 void FunscriptUndoSystem::ClearRedo() noexcept
 {
-	RedoStack.clear();
+	RedoStack.Clear();
 }
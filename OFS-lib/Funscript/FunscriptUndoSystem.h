@@ -1,26 +1,95 @@
 #pragma once
 
 #include "Funscript.h"
+#include "OFS_RingBuffer.h"
 
-// in a previous iteration
-// this looked a lot more sophisticated
-// while this is not memory efficient this turns out to be incredibly robust and flexible
+#include <memory>
+
+// the difference between two action vectors
+// stored as runs of removed/inserted actions, a modified action is a remove + insert
+// the runs are in ascending order of their index into the "from" vector
+class FunscriptDelta {
+public:
+	struct Run {
+		int32_t index;
+		int32_t removedCount;
+		int32_t insertedCount;
+	};
+	std::vector<Run> runs;
+	std::vector<FunscriptAction> removed;
+	std::vector<FunscriptAction> inserted;
+
+	static FunscriptDelta Create(const std::vector<FunscriptAction>& from, const std::vector<FunscriptAction>& to) noexcept;
+	// from -> to
+	void Apply(const std::vector<FunscriptAction>& from, std::vector<FunscriptAction>& to) const noexcept;
+	// to -> from
+	void Revert(const std::vector<FunscriptAction>& to, std::vector<FunscriptAction>& from) const noexcept;
+
+	inline bool Empty() const noexcept { return runs.empty(); }
+	inline size_t ByteSize() const noexcept {
+		return runs.capacity() * sizeof(Run)
+			+ (removed.capacity() + inserted.capacity()) * sizeof(FunscriptAction);
+	}
+};
+
+// in a previous iteration every state was a full copy of the script data
+// which added up to gigabytes with a couple of big scripts loaded
+// now only every n-th state is a full copy (keyframe) everything in between is a delta
 class ScriptState {
-private:
-	Funscript::FunscriptData data;
 public:
-	inline Funscript::FunscriptData& Data() { return data; }
 	int32_t type;
+	bool isKeyframe = false;
+	// changes from the state below this one to this one
+	FunscriptDelta delta;
+	// full copy of this state, always set for the bottom of a stack
+	std::unique_ptr<Funscript::FunscriptData> keyframe;
+	// delta & keyframe delta+varint encoded
+	// states which are far away from the top of the stack get stored like this
+	std::vector<uint8_t> compressed;
+
 	const std::string& Message() const;
+	void Compress() noexcept;
+	void Decompress() noexcept;
+
+	inline bool IsCompressed() const noexcept { return !compressed.empty(); }
+	inline size_t ByteSize() const noexcept {
+		return sizeof(ScriptState) + delta.ByteSize() + compressed.capacity()
+			+ (keyframe ? keyframe->Actions.capacity() * sizeof(FunscriptAction) : 0);
+	}
 
-	ScriptState(int32_t type, const Funscript::FunscriptData& data)
-		: type(type), data(data) {}
+	ScriptState(int32_t type = 0) noexcept
+		: type(type) {}
 };
 
 namespace OFS {
 	constexpr int32_t MaxScriptStateInMemory = 1000;
+	constexpr int32_t ScriptStateKeyframeInterval = 64;
+	// the top n states of a stack stay uncompressed
+	constexpr int32_t UncompressedScriptStates = 8;
 }
 
+class ScriptStateStack {
+	OFS::RingBuffer<ScriptState> states;
+	// the materialized state of states.back()
+	Funscript::FunscriptData top;
+	size_t byteSize = 0;
+
+	void compress(size_t idx) noexcept;
+	void decompress(size_t idx) noexcept;
+public:
+	void Push(int32_t type, const Funscript::FunscriptData& data) noexcept;
+	// moves the top state into data
+	void Pop(Funscript::FunscriptData& data) noexcept;
+	// drops the oldest count states, the UndoSystem decides when
+	void DropBottom(size_t count) noexcept;
+	void Clear() noexcept;
+
+	inline bool Empty() const noexcept { return states.empty(); }
+	inline size_t Size() const noexcept { return states.size(); }
+	inline const ScriptState& Back() const noexcept { return states.back(); }
+	inline const OFS::RingBuffer<ScriptState>& States() const noexcept { return states; }
+	inline size_t ByteSize() const noexcept { return byteSize + top.Actions.capacity() * sizeof(FunscriptAction); }
+};
 
 // this is part of the funscript class
 class FunscriptUndoSystem
@@ -29,10 +98,8 @@ class FunscriptUndoSystem
 
 	Funscript* script = nullptr;
 	void SnapshotRedo(int32_t type) noexcept;
-	// using vector as a stack...
-	// because std::stack can't be iterated
-	std::vector<ScriptState> UndoStack;
-	std::vector<ScriptState> RedoStack;
+	ScriptStateStack UndoStack;
+	ScriptStateStack RedoStack;
 
 	void Snapshot(int32_t type, bool clearRedo = true) noexcept;
 	void Undo() noexcept;
@@ -46,7 +113,8 @@ public:
 	static constexpr const char* UndoHistoryId = "Undo/Redo history";
 	void ShowUndoRedoHistory(bool* open);
 
-	inline bool MatchUndoTop(int32_t type) const noexcept { return !UndoEmpty() && UndoStack.back().type == type; }
-	inline bool UndoEmpty() const noexcept { return UndoStack.empty(); }
-	inline bool RedoEmpty() const noexcept { return RedoStack.empty(); }
+	inline bool MatchUndoTop(int32_t type) const noexcept { return !UndoEmpty() && UndoStack.Back().type == type; }
+	inline bool UndoEmpty() const noexcept { return UndoStack.Empty(); }
+	inline bool RedoEmpty() const noexcept { return RedoStack.Empty(); }
+	inline size_t ByteSize() const noexcept { return UndoStack.ByteSize() + RedoStack.ByteSize(); }
 };
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "OFS_Util.h"
+
+#include <vector>
+#include <cstdint>
+#include <utility>
+
+namespace OFS
+{
+	// double ended ring buffer which grows when it's full
+	// elements are indexed from the oldest (front) to the newest (back)
+	// removing from either end is O(1) unlike std::vector::erase(begin())
+	template<typename T>
+	class RingBuffer
+	{
+		std::vector<T> buffer;
+		size_t head = 0;
+		size_t count = 0;
+
+		inline size_t wrap(size_t idx) const noexcept { return idx & (buffer.size() - 1); }
+
+		void grow() noexcept
+		{
+			std::vector<T> grown(buffer.empty() ? 16 : buffer.size() * 2);
+			for (size_t i = 0; i < count; i++) {
+				grown[i] = std::move(buffer[wrap(head + i)]);
+			}
+			buffer = std::move(grown);
+			head = 0;
+		}
+	public:
+		inline size_t size() const noexcept { return count; }
+		inline bool empty() const noexcept { return count == 0; }
+
+		inline T& operator[](size_t idx) noexcept { FUN_ASSERT(idx < count, "out of bounds"); return buffer[wrap(head + idx)]; }
+		inline const T& operator[](size_t idx) const noexcept { FUN_ASSERT(idx < count, "out of bounds"); return buffer[wrap(head + idx)]; }
+
+		inline T& front() noexcept { return (*this)[0]; }
+		inline const T& front() const noexcept { return (*this)[0]; }
+		inline T& back() noexcept { return (*this)[count - 1]; }
+		inline const T& back() const noexcept { return (*this)[count - 1]; }
+
+		template<typename... Args>
+		inline T& emplace_back(Args&&... args) noexcept
+		{
+			if (count == buffer.size()) grow();
+			auto& elem = buffer[wrap(head + count)];
+			elem = T(std::forward<Args>(args)...);
+			count++;
+			return elem;
+		}
+
+		inline void pop_back() noexcept
+		{
+			FUN_ASSERT(count > 0, "buffer is empty");
+			back() = T();
+			count--;
+		}
+
+		inline void pop_front() noexcept
+		{
+			FUN_ASSERT(count > 0, "buffer is empty");
+			front() = T();
+			head = wrap(head + 1);
+			count--;
+		}
+
+		inline void clear() noexcept
+		{
+			while (!empty()) pop_back();
+			head = 0;
+		}
+	};
+}
@@ -2,6 +2,7 @@
 #include "FunscriptUndoSystem.h"
 
 #include <array>
+#include <algorithm>
 
 // this array provides strings for the StateType enum
 // for this to work the order needs to be maintained
@@ -45,13 +46,45 @@ const std::string& ScriptState::Message() const
 	return stateStrings[(int32_t)type];
 }
 
-void UndoSystem::Snapshot(StateType type, bool multi_script, Funscript* active, bool clearRedo) noexcept
+int32_t UndoSystem::MemoryBudgetMB = 256;
+
+size_t UndoSystem::byteSize() const noexcept
 {
-	UndoStack.emplace_back(multi_script); // tracking multi-script modifications
+	size_t size = 0;
+	for (auto&& script : *LoadedScripts) {
+		size += script->undoSystem->ByteSize();
+	}
+	return size;
+}
 
-	if (UndoStack.size() > OFS::MaxScriptStateInMemory) {
-		UndoStack.erase(UndoStack.begin()); // erase first UndoContext
+void UndoSystem::evictOldest() noexcept
+{
+	const size_t budget = (size_t)MemoryBudgetMB * 1024 * 1024;
+	while (UndoStack.size() > 1 && (UndoStack.size() > OFS::MaxScriptStateInMemory || byteSize() > budget)) {
+		// a script has one state per context it's part of so the oldest contexts
+		// map to the oldest states of every script involved.
+		// evicting a batch at once means only one keyframe gets rebuilt per script
+		size_t count = std::min<size_t>(UndoStack.size() - 1, OFS::ScriptStateKeyframeInterval);
+		std::vector<std::pair<std::shared_ptr<Funscript>, size_t>> drops;
+		for (size_t i = 0; i < count; i++) {
+			for (auto& weak : UndoStack.front().Scripts) {
+				auto script = weak.lock();
+				if (!script) continue; // closed in the meantime
+				auto it = std::find_if(drops.begin(), drops.end(), [&](auto& drop) { return drop.first == script; });
+				if (it != drops.end()) it->second++;
+				else drops.emplace_back(std::move(script), 1);
+			}
+			UndoStack.pop_front();
+		}
+		for (auto& [script, dropCount] : drops) {
+			script->undoSystem->UndoStack.DropBottom(dropCount);
+		}
 	}
+}
+
+void UndoSystem::Snapshot(StateType type, bool multi_script, Funscript* active, bool clearRedo) noexcept
+{
+	auto& context = UndoStack.emplace_back(multi_script); // tracking multi-script modifications
 
 	// redo gets cleared after every snapshot
 	if (clearRedo && !RedoStack.empty())
@@ -61,42 +94,44 @@ void UndoSystem::Snapshot(StateType type, bool multi_script, Funscript* active,
 	if (multi_script) {
 		for (auto&& script : *LoadedScripts) {
 			script->undoSystem->Snapshot(type, clearRedo);
+			context.Scripts.emplace_back(script);
 		}
 	}
 	else {
 		active->undoSystem->Snapshot(type, clearRedo);
+		auto it = std::find_if(LoadedScripts->begin(), LoadedScripts->end(),
+			[active](auto& script) { return script.get() == active; });
+		if (it != LoadedScripts->end()) context.Scripts.emplace_back(*it);
 	}
+
+	evictOldest();
 }
 
-void UndoSystem::Undo(Funscript* active) noexcept
+void UndoSystem::Undo() noexcept
 {
 	if (UndoStack.empty()) return;
 
-	if (UndoStack.back().IsMultiscriptModification) {
-		for (auto&& script : *LoadedScripts) {
+	// only the scripts which were part of the snapshot get reverted
+	// otherwise the script stacks would get out of step with this one
+	for (auto& weak : UndoStack.back().Scripts) {
+		if (auto script = weak.lock()) {
 			script->undoSystem->Undo();
 		}
 	}
-	else {
-		active->undoSystem->Undo();
-	}
 
 	RedoStack.emplace_back(std::move(UndoStack.back()));
 	UndoStack.pop_back();
 }
 
-void UndoSystem::Redo(Funscript* active) noexcept
+void UndoSystem::Redo() noexcept
 {
 	if (RedoStack.empty()) return;
 
-	if (RedoStack.back().IsMultiscriptModification) {
-		for (auto&& script : *LoadedScripts) {
+	for (auto& weak : RedoStack.back().Scripts) {
+		if (auto script = weak.lock()) {
 			script->undoSystem->Redo();
 		}
 	}
-	else {
-		active->undoSystem->Redo();
-	}
 	UndoStack.emplace_back(std::move(RedoStack.back()));
 	RedoStack.pop_back();
 }
@@ -104,4 +139,4 @@ void UndoSystem::Redo(Funscript* active) noexcept
 void UndoSystem::ClearRedo() noexcept
 {
 	RedoStack.clear();
-}
+}
\ No newline at end of file
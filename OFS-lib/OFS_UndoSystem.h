@@ -4,6 +4,8 @@
 #include <memory>
 #include <string>
 
+#include "OFS_RingBuffer.h"
+
 enum StateType : int32_t {
 	ADD_EDIT_ACTIONS = 0,
 	ADD_EDIT_ACTION = 1,
@@ -49,6 +51,8 @@ class UndoSystem
 private:
 	struct UndoContext {
 		bool IsMultiscriptModification = false;
+		// every script which pushed a state for this context
+		std::vector<std::weak_ptr<class Funscript>> Scripts;
 
 		UndoContext() {}
 
@@ -58,19 +62,27 @@ private:
 
 		}
 	};
-	std::vector<UndoContext> UndoStack;
-	std::vector<UndoContext> RedoStack;
+	OFS::RingBuffer<UndoContext> UndoStack;
+	OFS::RingBuffer<UndoContext> RedoStack;
 	void ClearRedo() noexcept;
+	size_t byteSize() const noexcept;
+	// drops the oldest contexts from all involved scripts
+	// until the stack is within count & memory budget
+	void evictOldest() noexcept;
 public:
 	std::vector<std::shared_ptr<class Funscript>>* LoadedScripts = nullptr;
 
+	// budget for the undo/redo states of all loaded scripts
+	// when exceeded the oldest undo steps get dropped
+	static int32_t MemoryBudgetMB;
+
 	UndoSystem(std::vector<std::shared_ptr<class Funscript>>* scripts) {
 		LoadedScripts = scripts;
 	}
 
 	void Snapshot(StateType type, bool multi_script, class Funscript* active, bool clearRedo = true) noexcept;
-	void Undo(class Funscript* active) noexcept;
-	void Redo(class Funscript* active) noexcept;
+	void Undo() noexcept;
+	void Redo() noexcept;
 
 	inline bool UndoEmpty() const noexcept { return UndoStack.empty(); }
 	inline bool RedoEmpty() const noexcept { return RedoStack.empty(); }
@@ -344,6 +344,32 @@ public:
 		return (prefPath / rel).string();
 	}
 
+	// FNV-1a, whole 64bit words at a time
+	static uint64_t Checksum(const void* data, size_t size, uint64_t hash = 14695981039346656037ull) noexcept {
+		constexpr uint64_t prime = 1099511628211ull;
+		const uint8_t* bytes = (const uint8_t*)data;
+		size_t i = 0;
+		for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+			uint64_t word;
+			std::memcpy(&word, bytes + i, sizeof(uint64_t));
+			hash = (hash ^ word) * prime;
+		}
+		for (; i < size; i++) {
+			hash = (hash ^ bytes[i]) * prime;
+		}
+		return hash;
+	}
+
+	// size & modification time of a file, cache entries use them to detect stale data
+	static bool FileStat(const std::string& path, uint64_t& size, int64_t& mtime) noexcept {
+		std::error_code ec;
+		auto filePath = PathFromString(path);
+		size = std::filesystem::file_size(filePath, ec);
+		if (ec) return false;
+		mtime = std::filesystem::last_write_time(filePath, ec).time_since_epoch().count();
+		return !ec;
+	}
+
 	static bool CreateDirectories(const std::filesystem::path& dirs) noexcept {
 		std::error_code ec;
 		std::filesystem::create_directories(dirs, ec);
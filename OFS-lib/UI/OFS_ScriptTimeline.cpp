@@ -46,8 +46,17 @@ void ScriptTimeline::updateSelection(bool clear)
 
 void ScriptTimeline::FfmpegAudioProcessingFinished(SDL_Event& ev) noexcept
 {
-	ShowAudioWaveform = true;
-	LOG_INFO("Audio processing complete.");
+	processingAudio = false;
+	if (cacheLookupPending) {
+		// the video changed while processing, whatever got processed belongs to the old one
+		cacheLookupPending = false;
+		loadCachedWaveform();
+		return;
+	}
+	if ((intptr_t)ev.user.data1) {
+		ShowAudioWaveform = true;
+		LOG_INFO("Audio processing complete.");
+	}
 }
 
 void ScriptTimeline::setup(UndoSystem* undoSystem)
@@ -194,7 +203,7 @@ void ScriptTimeline::mouse_drag(SDL_Event& ev) noexcept
 	else if (IsMoving) {
 		if (!activeScript->HasSelection()) { IsMoving = false; return; }
 		auto mousePos = ImGui::GetMousePos();
-		auto& toBeMoved = activeScript->Selection()[0];
+		auto toBeMoved = activeScript->Selection()[0];
 		auto newAction = getActionForPoint(active_canvas_pos, active_canvas_size, mousePos, frameTimeMs);
 		if (newAction.at != toBeMoved.at || newAction.pos != toBeMoved.pos) {
 			const FunscriptAction* nearbyAction = nullptr;
@@ -242,6 +251,51 @@ void ScriptTimeline::mouse_scroll(SDL_Event& ev) noexcept
 void ScriptTimeline::videoLoaded(SDL_Event& ev) noexcept
 {
 	videoPath = (const char*)ev.user.data1;
+	if (processingAudio) {
+		// the processing thread owns the waveform until it reports back
+		// the cache for the new video gets looked up in FfmpegAudioProcessingFinished
+		waveform.Cancel();
+		ShowAudioWaveform = false;
+		cacheLookupPending = true;
+		return;
+	}
+	loadCachedWaveform();
+}
+
+void ScriptTimeline::loadCachedWaveform() noexcept
+{
+	ClearAudioWaveform();
+	cacheLoadGeneration++;
+	if (videoPath == nullptr) return;
+
+	// verifying & copying the cache of a long video takes a moment, that happens on a worker
+	struct CacheLoadData {
+		ScriptTimeline* timeline;
+		uint32_t generation;
+		std::string videoPath;
+		OFS_Waveform waveform;
+		bool loaded = false;
+	};
+	auto data = new CacheLoadData{ this, cacheLoadGeneration, videoPath };
+	auto thread = [](void* user) -> int {
+		auto data = (CacheLoadData*)user;
+		data->loaded = data->waveform.LoadCache(data->videoPath);
+		EventSystem::SingleShot([](void* ctx) {
+			// this code executes on the main thread during event processing
+			auto data = (CacheLoadData*)ctx;
+			auto& timeline = *data->timeline;
+			// dropped if another video got opened or the waveform got processed in the meantime
+			if (data->loaded && data->generation == timeline.cacheLoadGeneration && !timeline.processingAudio) {
+				timeline.waveform.TakeSamples(data->waveform);
+				timeline.ShowAudioWaveform = true;
+				LOG_INFO("Loaded cached audio waveform.");
+			}
+			delete data;
+		}, data);
+		return 0;
+	};
+	auto handle = SDL_CreateThread(thread, "OFS_LoadWaveformCache", data);
+	SDL_DetachThread(handle);
 }
 
 void ScriptTimeline::ShowScriptPositions(bool* open, float currentPositionMs, float durationMs, float frameTimeMs, const std::vector<std::shared_ptr<Funscript>>* scripts, int activeScriptIdx) noexcept
@@ -480,32 +534,44 @@ void ScriptTimeline::ShowScriptPositions(bool* open, float currentPositionMs, fl
 #else
 				auto ffmpegPath = std::filesystem::path("ffmpeg");
 #endif
-				auto outputPath = Util::Prefpath("tmp");
-				if (!Util::CreateDirectories(outputPath)) {
-					return 0;
+				std::string videoPath(ctx.videoPath);
+				bool succ;
+				if (Util::StringEqualsInsensitive(Util::PathFromString(videoPath).extension().u8string(), ".mp3")) {
+					// mp3s get decoded directly on all cores, no need for ffmpeg
+					succ = ctx.waveform.LoadMP3(videoPath);
+					if (!succ) { LOGF_ERROR("Failed to decode mp3. (path: \"%s\")", videoPath.c_str()); }
 				}
-				outputPath = (std::filesystem::path(outputPath) / "audio.mp3").u8string();
-
-				bool succ = ctx.waveform.GenerateMP3(ffmpegPath.u8string(), std::string(ctx.videoPath), outputPath);
-				if (!succ) { LOGF_ERROR("Failed to output mp3 from video. (ffmpeg_path: \"%s\")", ffmpegPath.u8string().c_str()); return 0;	}
-				succ = ctx.waveform.LoadMP3(outputPath);
-				if (!succ) { LOGF_ERROR("Failed load mp3. (path: \"%s\")", outputPath.c_str());	return 0; }
-				EventSystem::PushEvent(ScriptTimelineEvents::FfmpegAudioProcessingFinished);
+				else {
+					succ = ctx.waveform.GenerateFromVideo(ffmpegPath.u8string(), videoPath, ctx.waveformDurationMs);
+					if (!succ) { LOGF_ERROR("Failed to decode audio from video. (ffmpeg_path: \"%s\")", ffmpegPath.u8string().c_str()); }
+				}
+				if (succ) {
+					ctx.waveform.WriteCache(videoPath);
+				}
+				// always report back, the main thread doesn't touch the waveform until then
+				EventSystem::PushEvent(ScriptTimelineEvents::FfmpegAudioProcessingFinished, (void*)(intptr_t)succ);
 				return 0;
 			};
 			if (ImGui::BeginMenu("Audio waveform")) {
 				ImGui::DragFloat("Scale", &ScaleAudio, 0.01f, 0.01f, 10.f, "%.3f", ImGuiSliderFlags_AlwaysClamp);
 				ImGui::ColorEdit3("Color", &WaveformColor.Value.x, ImGuiColorEditFlags_None);
-				if (ImGui::MenuItem("Enable waveform", NULL, &ShowAudioWaveform, !waveform.BusyGenerating())) {}
-				if (ImGui::MenuItem(waveform.BusyGenerating() 
-					? "Processing audio..." 
-					: "Update waveform", NULL, false, !waveform.BusyGenerating() && videoPath != nullptr)) {
-					if (!waveform.BusyGenerating()) {
-						ShowAudioWaveform = false; // gets switched true after processing
-						auto handle = SDL_CreateThread(updateAudioWaveformThread, "OFS_GenWaveform", this);
-						SDL_DetachThread(handle);
+				if (ImGui::MenuItem("Enable waveform", NULL, &ShowAudioWaveform, !processingAudio)) {}
+				if (processingAudio) {
+					char label[64];
+					stbsp_snprintf(label, sizeof(label), "Processing audio... %.0f%%", waveform.Progress() * 100.f);
+					ImGui::MenuItem(label, NULL, false, false);
+					if (ImGui::MenuItem("Cancel")) {
+						waveform.Cancel();
 					}
 				}
+				else if (ImGui::MenuItem("Update waveform", NULL, false, videoPath != nullptr)) {
+					ShowAudioWaveform = false; // gets switched true after processing
+					waveformDurationMs = durationMs;
+					processingAudio = true;
+					cacheLoadGeneration++;
+					auto handle = SDL_CreateThread(updateAudioWaveformThread, "OFS_GenWaveform", this);
+					SDL_DetachThread(handle);
+				}
 				if (ShowAudioWaveform) { if (ImGui::MenuItem("Enable P-Mode " ICON_WARNING_SIGN, 0, &WaveformPartyMode)) {} }
 				ImGui::EndMenu();
 			}
@@ -537,12 +603,6 @@ void ScriptTimeline::DrawAudioWaveform(const OverlayDrawingCtx& ctx) noexcept
 {
 	OFS_PROFILE(__FUNCTION__);
 
-#if 0
-	if (!ShowAudioWaveform) {
-		waveform.LoadMP3(Util::Prefpath("tmp/audio.mp3"));
-		EventSystem::PushEvent(ScriptTimelineEvents::FfmpegAudioProcessingFinished);
-	}
-#endif
 	auto& canvas_pos = ctx.canvas_pos;
 	auto& canvas_size = ctx.canvas_size;
 	const auto draw_list = ctx.draw_list;
@@ -555,26 +615,11 @@ void ScriptTimeline::DrawAudioWaveform(const OverlayDrawingCtx& ctx) noexcept
 		const int total_samples = end_index - start_index;
 
 		WaveformViewport = ImGui::GetWindowViewport();
-		auto renderWaveform = [](const std::vector<float>& samples, ScriptTimeline* timeline, const OverlayDrawingCtx& ctx, int start_index, int end_index)
+		auto renderWaveform = [](const std::vector<float>& samples, const OFS_WaveformLOD& lod, ScriptTimeline* timeline, const OverlayDrawingCtx& ctx, int start_index, int end_index)
 		{
 			OFS_PROFILE("renderWaveform");
-			const int total_samples = end_index - start_index;
-
-			const int line_merge = 1 + (total_samples / ctx.canvas_size.x);
-
-			timeline->WaveformLineBuffer.clear();
-			float sample = 0.f;
-			for (int i = start_index; i <= end_index; i++) {
-				if (i >= 0 && i < samples.size()) {
-					float s = samples[i];
-					sample = std::max(sample, s);
-				}
-
-				if (i % line_merge == 0) {
-					timeline->WaveformLineBuffer.emplace_back(sample);
-					sample = 0.f;
-				}
-			}
+			// at most one value per pixel no matter how much is visible
+			lod.Resample(samples, start_index, end_index, ctx.canvas_size.x, timeline->WaveformLineBuffer);
 			glActiveTexture(GL_TEXTURE1);
 			glBindTexture(GL_TEXTURE_1D, timeline->WaveformTex);
 			glTexImage1D(GL_TEXTURE_1D, 0, GL_RED, timeline->WaveformLineBuffer.size(), 0, GL_RED, GL_FLOAT, timeline->WaveformLineBuffer.data());
@@ -614,7 +659,7 @@ void ScriptTimeline::DrawAudioWaveform(const OverlayDrawingCtx& ctx) noexcept
 		renderWaveform(waveform.SamplesMid, MidRangeCol, waveform.LowMax);
 		renderWaveform(waveform.SamplesLow, LowRangeCol, 0.f);
 #else
-		renderWaveform(waveform.SamplesHigh, this, ctx, start_index, end_index);
+		renderWaveform(waveform.SamplesFull, waveform.FullLOD, this, ctx, start_index, end_index);
 #endif
 	}
 }
\ No newline at end of file
@@ -111,7 +111,14 @@ private:
 	
 	bool ShowAudioWaveform = false;
 	float ScaleAudio = 1.f;
+	float waveformDurationMs = 0.f;
 	OFS_Waveform waveform;
+	// set from starting the processing thread until FfmpegAudioProcessingFinished
+	bool processingAudio = false;
+	bool cacheLookupPending = false;
+	// cache loads run on a worker, results of an outdated load get dropped
+	uint32_t cacheLoadGeneration = 0;
+	void loadCachedWaveform() noexcept;
 public:
 	static constexpr const char* PositionsId = "Positions";
 
@@ -1,6 +1,11 @@
 #include "OFS_Waveform.h"
 #include "OFS_Util.h"
 #include "OFS_Profiling.h"
+#include "OFS_MappedFile.h"
+
+#include "SDL_thread.h"
+#include "SDL_atomic.h"
+#include "SDL_cpuinfo.h"
 
 //#define MINIMP3_ONLY_SIMD
 //#define MINIMP3_NO_SIMD
@@ -10,89 +15,529 @@
 #include "minimp3.h"
 #include "minimp3_ex.h"
 
-bool OFS_Waveform::LoadMP3(const std::string& path) noexcept
+#include "reproc++/reproc.hpp"
+
+#include <cmath>
+#include <array>
+#include <xmmintrin.h>
+#include <emmintrin.h>
+#include <pmmintrin.h>
+#include <cstring>
+#include <filesystem>
+
+void OFS_WaveformLOD::Build(const std::vector<float>& samples) noexcept
 {
 	OFS_BENCHMARK(__FUNCTION__);
-	generating = true;
+	Levels.clear();
+	if (samples.size() <= Reduction) return;
 
-	static mp3dec_t mp3d;
-	mp3dec_file_info_t info;
+	// the rms gets merged through the sum of squares, buckets at the end can be partial
+	auto& first = Levels.emplace_back();
+	first.reserve((samples.size() + Reduction - 1) / Reduction);
+	for (size_t i = 0; i < samples.size(); i += Reduction) {
+		size_t end = std::min(i + Reduction, samples.size());
+		OFS_WaveformBucket bucket{ samples[i], samples[i], 0.f };
+		for (size_t j = i; j < end; j++) {
+			bucket.min = std::min(bucket.min, samples[j]);
+			bucket.max = std::max(bucket.max, samples[j]);
+			bucket.rms += samples[j] * samples[j];
+		}
+		bucket.rms = std::sqrt(bucket.rms / (float)(end - i));
+		first.emplace_back(bucket);
+	}
 
-	SamplesLow.clear();
-	SamplesMid.clear();
-	SamplesHigh.clear();
+	size_t bucketSize = Reduction;
+	while (Levels.back().size() > Reduction) {
+		auto& prev = Levels.back();
+		std::vector<OFS_WaveformBucket> level;
+		level.reserve((prev.size() + Reduction - 1) / Reduction);
+		for (size_t i = 0; i < prev.size(); i += Reduction) {
+			size_t end = std::min(i + Reduction, prev.size());
+			OFS_WaveformBucket bucket = prev[i];
+			float squares = 0.f;
+			float count = 0.f;
+			for (size_t j = i; j < end; j++) {
+				// only the very last bucket of a level can be partial
+				float childCount = std::min(bucketSize, samples.size() - j * bucketSize);
+				bucket.min = std::min(bucket.min, prev[j].min);
+				bucket.max = std::max(bucket.max, prev[j].max);
+				squares += prev[j].rms * prev[j].rms * childCount;
+				count += childCount;
+			}
+			bucket.rms = std::sqrt(squares / count);
+			level.emplace_back(bucket);
+		}
+		Levels.emplace_back(std::move(level));
+		bucketSize *= Reduction;
+	}
+}
 
-	mp3dec_init(&mp3d);
+void OFS_WaveformLOD::Resample(const std::vector<float>& samples, int32_t startIdx, int32_t endIdx, int32_t width, std::vector<float>& output) const noexcept
+{
+	output.clear();
+	const int32_t totalSamples = endIdx - startIdx;
+	if (totalSamples <= 0 || width <= 0) return;
 
-	struct Mp3Context {
-		OFS_Waveform* wave = nullptr;
-		float lowPeak = 0.f;
-		float midPeak = 0.f;
-		float highPeak = 0.f;
+	auto sampleAt = [&](int32_t idx) noexcept {
+		return idx >= 0 && idx < (int32_t)samples.size() ? samples[idx] : 0.f;
 	};
-	Mp3Context ctx;
-	ctx.wave = this;
-	mp3dec_iterate(path.c_str(),
+
+	if (totalSamples <= width) {
+		for (int32_t i = startIdx; i <= endIdx; i++) {
+			output.emplace_back(sampleAt(i));
+		}
+		return;
+	}
+
+	// the coarsest level with at least one bucket per pixel
+	const double samplesPerPixel = (double)totalSamples / width;
+	int32_t level = -1;
+	int64_t bucketSize = 1;
+	while (level + 1 < (int32_t)Levels.size() && bucketSize * Reduction <= samplesPerPixel) {
+		level++;
+		bucketSize *= Reduction;
+	}
+
+	output.reserve(width);
+	for (int32_t px = 0; px < width; px++) {
+		// the pixel range gets snapped to the buckets of the level
+		int64_t first = startIdx + (int64_t)(px * samplesPerPixel);
+		int64_t last = startIdx + (int64_t)((px + 1) * samplesPerPixel);
+		first = first >= 0 ? first / bucketSize : (first - bucketSize + 1) / bucketSize;
+		last = last >= 0 ? last / bucketSize : (last - bucketSize + 1) / bucketSize;
+		last = std::max(first + 1, last);
+
+		float peak = 0.f;
+		if (level < 0) {
+			for (int64_t i = first; i < last; i++) {
+				peak = std::max(peak, sampleAt(i));
+			}
+		}
+		else {
+			auto& buckets = Levels[level];
+			first = std::max<int64_t>(first, 0);
+			last = std::min<int64_t>(last, buckets.size());
+			for (int64_t i = first; i < last; i++) {
+				peak = std::max(peak, buckets[i].max);
+			}
+		}
+		output.emplace_back(peak);
+	}
+}
+
+// the filter state decays into denormals during silence which are extremely slow
+// flush them to zero for the thread running the filters, the previous mode gets restored
+struct WaveformDenormalsScope
+{
+	uint32_t csr = _mm_getcsr();
+
+	WaveformDenormalsScope() noexcept
+	{
+		_MM_SET_FLUSH_ZERO_MODE(_MM_FLUSH_ZERO_ON);
+		_MM_SET_DENORMALS_ZERO_MODE(_MM_DENORMALS_ZERO_ON);
+	}
+	~WaveformDenormalsScope() noexcept { _mm_setcsr(csr); }
+};
+
+// 4 biquads running side by side, one per sse lane
+// transposed direct form 2
+struct WaveformFilterBank
+{
+	__m128 b0, b1, b2, a1, a2;
+	__m128 z1 = _mm_setzero_ps();
+	__m128 z2 = _mm_setzero_ps();
+
+	struct Coefficients {
+		float b0, b1, b2, a1, a2;
+	};
+
+	// filters from the audio eq cookbook
+	enum class Type { Lowpass, Highpass, Bandpass };
+	// the bandpass passes [frequency, upperFrequency], the others use a butterworth q
+	static Coefficients Biquad(Type type, float sampleRate, float frequency, float upperFrequency = 0.f) noexcept
+	{
+		constexpr float Pi = 3.14159265f;
+		const float nyquistLimit = sampleRate * 0.45f;
+		frequency = std::min(frequency, nyquistLimit);
+		float alpha;
+		if (type == Type::Bandpass) {
+			upperFrequency = std::min(upperFrequency, nyquistLimit);
+			float bandwidth = std::log2(upperFrequency / frequency);
+			frequency = std::sqrt(frequency * upperFrequency);
+			float w0 = 2.f * Pi * frequency / sampleRate;
+			alpha = std::sin(w0) * std::sinh(std::log(2.f) / 2.f * bandwidth * w0 / std::sin(w0));
+		}
+		else {
+			constexpr float Q = 0.70710678f;
+			alpha = std::sin(2.f * Pi * frequency / sampleRate) / (2.f * Q);
+		}
+		const float cosW0 = std::cos(2.f * Pi * frequency / sampleRate);
+		const float a0 = 1.f + alpha;
+
+		Coefficients c;
+		switch (type) {
+			case Type::Lowpass:
+				c.b1 = 1.f - cosW0;
+				c.b0 = c.b2 = c.b1 / 2.f;
+				break;
+			case Type::Highpass:
+				c.b1 = -(1.f + cosW0);
+				c.b0 = c.b2 = -c.b1 / 2.f;
+				break;
+			case Type::Bandpass:
+				c.b0 = alpha;
+				c.b1 = 0.f;
+				c.b2 = -alpha;
+				break;
+		}
+		c.b0 /= a0; c.b1 /= a0; c.b2 /= a0;
+		c.a1 = (-2.f * cosW0) / a0;
+		c.a2 = (1.f - alpha) / a0;
+		return c;
+	}
+
+	void Init(const std::array<Coefficients, 4>& lanes) noexcept
+	{
+		auto load = [&lanes](float Coefficients::* c) noexcept {
+			return _mm_setr_ps(lanes[0].*c, lanes[1].*c, lanes[2].*c, lanes[3].*c);
+		};
+		b0 = load(&Coefficients::b0);
+		b1 = load(&Coefficients::b1);
+		b2 = load(&Coefficients::b2);
+		a1 = load(&Coefficients::a1);
+		a2 = load(&Coefficients::a2);
+		z1 = _mm_setzero_ps();
+		z2 = _mm_setzero_ps();
+	}
+
+	inline __m128 Process(__m128 x) noexcept
+	{
+		__m128 y = _mm_add_ps(_mm_mul_ps(b0, x), z1);
+		z1 = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(b1, x), _mm_mul_ps(a1, y)), z2);
+		z2 = _mm_sub_ps(_mm_mul_ps(b2, x), _mm_mul_ps(a2, y));
+		return y;
+	}
+};
+
+// turns 16bit pcm into lines of the low, mid & high frequency range plus the unfiltered signal
+// the peaks carry over from one line into the next which smooths the waveform
+struct WaveformAccumulator
+{
+	// mp3 frames are 1152 samples
+	static constexpr int SamplesPerLine = 1152 / 32;
+	static constexpr float LowRangeMax = 500.f;
+	static constexpr float MidRangeMax = 6000.f;
+
+	std::vector<float> Low;
+	std::vector<float> Mid;
+	std::vector<float> High;
+	std::vector<float> Full;
+	float lowPeak = 0.f;
+	float midPeak = 0.f;
+	float highPeak = 0.f;
+	float fullPeak = 0.f;
+
+	int32_t sampleRate = 0;
+	WaveformFilterBank filter;
+
+	// lanes are lowpass 500, bandpass 500-6000, highpass 6000 & the unfiltered signal
+	inline void SetSampleRate(int32_t hz) noexcept
+	{
+		if (hz == sampleRate || hz <= 0) return;
+		sampleRate = hz;
+		using Type = WaveformFilterBank::Type;
+		filter.Init({
+			WaveformFilterBank::Biquad(Type::Lowpass, hz, LowRangeMax),
+			WaveformFilterBank::Biquad(Type::Bandpass, hz, LowRangeMax, MidRangeMax),
+			WaveformFilterBank::Biquad(Type::Highpass, hz, MidRangeMax),
+			WaveformFilterBank::Coefficients{ 1.f, 0.f, 0.f, 0.f, 0.f }
+		});
+	}
+
+	inline void AddLine(const int16_t* pcm) noexcept
+	{
+		FUN_ASSERT(sampleRate > 0, "sample rate wasn't set");
+		const __m128 signMask = _mm_set1_ps(-0.f);
+		__m128 sum = _mm_setzero_ps();
+		for (int i = 0; i < SamplesPerLine; i++) {
+			// [low, mid, high, full]
+			__m128 bands = filter.Process(_mm_set1_ps(pcm[i] * 0.5f));
+			sum = _mm_add_ps(sum, _mm_andnot_ps(signMask, bands));
+		}
+		alignas(16) float sums[4];
+		_mm_store_ps(sums, sum);
+
+		lowPeak = (lowPeak + sums[0]) / (float)SamplesPerLine;
+		midPeak = (midPeak + sums[1]) / (float)SamplesPerLine;
+		highPeak = (highPeak + sums[2]) / (float)SamplesPerLine;
+		fullPeak = (fullPeak + sums[3]) / (float)SamplesPerLine;
+
+		Low.emplace_back(lowPeak);
+		Mid.emplace_back(midPeak);
+		High.emplace_back(highPeak);
+		Full.emplace_back(fullPeak);
+	}
+
+	// keeps the peaks
+	inline void ClearLines() noexcept
+	{
+		Low.clear();
+		Mid.clear();
+		High.clear();
+		Full.clear();
+	}
+};
+
+// a frame can reference data of the frames in front of it (bit reservoir, overlap & synthesis state)
+// a chunk decodes this many frames in front of it first and throws their lines away.
+// that also settles the peaks of the accumulator so the chunks stitch together seamlessly
+static constexpr size_t WarmupFrames = 8;
+static constexpr size_t MinFramesPerChunk = 2048;
+// more chunks than threads so progress gets reported while decoding
+static constexpr int32_t ChunksPerThread = 8;
+
+bool OFS_Waveform::LoadMP3(const std::string& path) noexcept
+{
+	OFS_BENCHMARK(__FUNCTION__);
+	generating = true;
+	cancel = false;
+	progress = 0.f;
+	OFS_MappedFile file;
+	bool succ = file.Open(path) && DecodeMP3(file.Data(), file.Size(), std::max(SDL_GetCPUCount(), 1));
+	progress = 1.f;
+	generating = false;
+	return succ;
+}
+
+bool OFS_Waveform::DecodeMP3(const uint8_t* data, size_t size, int32_t threadCount) noexcept
+{
+	OFS_BENCHMARK(__FUNCTION__);
+	Clear();
+
+	// finding the frames only parses the headers, that's fast
+	std::vector<uint64_t> frames;
+	mp3dec_iterate_buf(data, size,
 		[](void* user_data, const uint8_t* frame,
 			int frame_size, int free_format_bytes,
 			size_t buf_size, uint64_t offset,
-			mp3dec_frame_info_t* info) -> int 
+			mp3dec_frame_info_t* info) -> int
 		{
-			constexpr float LowRangeMin = 0.f; constexpr float LowRangeMax = 500.f;
-			constexpr float MidRangeMin = 501.f; constexpr float MidRangeMax = 6000.f;
-			constexpr float HighRangeMin = 6001.f; constexpr float HighRangeMax = 20000.f;
-			Mp3Context* ctx = (Mp3Context*)user_data;
-			mp3d_sample_t pcm[MINIMP3_MAX_SAMPLES_PER_FRAME];
-			auto samples = mp3dec_decode_frame(&mp3d, frame, buf_size, pcm, info);
-
-			FUN_ASSERT(samples <= 1152, "got more samples than expected");
-			// 1152 is the sample count per frame
-			constexpr int SamplesPerLine = 1152/32;
-
-			auto shortToFloat = [](int16_t pcmVal) -> float {
-				return (1.0f/32768.0f) * pcmVal;
-			};
-
-			for(int sampleIdx=0; sampleIdx < samples; sampleIdx += SamplesPerLine)
-			{
-				//float lowPeak = 0.f, midPeak = 0.f, highPeak = 0.f;
-				//int16_t lowPeak = 0, midPeak = 0, highPeak = 0;
-				for (int i = 0; i < SamplesPerLine; i++) { 
-					mp3d_sample_t sample = pcm[sampleIdx + i];
-					if (sample == 0) continue;
-					sample = std::abs(sample/2);
-
-					if (sample <= LowRangeMax) {
-						// low range
-						//lowPeak = std::max(lowPeak, sample);
-						ctx->lowPeak += sample;
-					}
-					if (sample <= MidRangeMax) {
-						// mid range
-						//midPeak = std::max(midPeak, sample);
-						ctx->midPeak += sample;
-					}
-					if (sample <= HighRangeMax) {
-						// high range
-						//highPeak = std::max(highPeak, sample);
-						ctx->highPeak += sample;
+			((std::vector<uint64_t>*)user_data)->push_back(offset);
+			return 0;
+	}, &frames);
+	if (frames.empty()) return false;
+
+	struct Chunk {
+		size_t firstFrame;
+		size_t lastFrame;
+		WaveformAccumulator lines;
+	};
+	threadCount = std::max(threadCount, 1);
+	const int32_t chunkCount = Util::Clamp<int32_t>(frames.size() / MinFramesPerChunk, 1, threadCount * ChunksPerThread);
+	const size_t framesPerChunk = (frames.size() + chunkCount - 1) / chunkCount;
+	std::vector<Chunk> chunks(chunkCount);
+	for (int32_t i = 0; i < chunkCount; i++) {
+		chunks[i].firstFrame = i * framesPerChunk;
+		chunks[i].lastFrame = std::min(chunks[i].firstFrame + framesPerChunk, frames.size());
+	}
+
+	struct DecodeData {
+		const uint8_t* data;
+		size_t size;
+		const std::vector<uint64_t>* frames;
+		std::vector<Chunk>* chunks;
+		OFS_Waveform* wave;
+		SDL_atomic_t next;
+		SDL_atomic_t finished;
+	};
+	DecodeData decode{ data, size, &frames, &chunks, this };
+	SDL_AtomicSet(&decode.next, 0);
+	SDL_AtomicSet(&decode.finished, 0);
+
+	auto worker = [](void* user) -> int {
+		auto& decode = *(DecodeData*)user;
+		WaveformDenormalsScope denormals;
+		// every thread has its own decoder
+		mp3dec_t mp3d;
+		mp3dec_frame_info_t info;
+		mp3d_sample_t pcm[MINIMP3_MAX_SAMPLES_PER_FRAME];
+		int32_t idx;
+		const int32_t chunkCount = decode.chunks->size();
+		while (!decode.wave->cancel && (idx = SDL_AtomicAdd(&decode.next, 1)) < chunkCount) {
+			auto& chunk = (*decode.chunks)[idx];
+			mp3dec_init(&mp3d);
+			size_t start = chunk.firstFrame > WarmupFrames ? chunk.firstFrame - WarmupFrames : 0;
+			for (size_t i = start; i < chunk.lastFrame && !decode.wave->cancel; i++) {
+				if (i == chunk.firstFrame) chunk.lines.ClearLines();
+
+				uint64_t offset = (*decode.frames)[i];
+				auto samples = mp3dec_decode_frame(&mp3d, decode.data + offset, decode.size - offset, pcm, &info);
+				FUN_ASSERT(samples <= 1152, "got more samples than expected");
+				if (info.channels > 1) {
+					// samples are per channel & interleaved, the filters want mono
+					for (int sampleIdx = 0; sampleIdx < samples; sampleIdx++) {
+						int32_t sum = 0;
+						for (int c = 0; c < info.channels; c++) sum += pcm[sampleIdx * info.channels + c];
+						pcm[sampleIdx] = sum / info.channels;
 					}
 				}
-				ctx->lowPeak /= (float)SamplesPerLine;
-				ctx->midPeak /= (float)SamplesPerLine;
-				ctx->highPeak /= (float)SamplesPerLine;
+				chunk.lines.SetSampleRate(info.hz);
+				for (int sampleIdx = 0; sampleIdx < samples; sampleIdx += WaveformAccumulator::SamplesPerLine) {
+					chunk.lines.AddLine(pcm + sampleIdx);
+				}
+			}
+			decode.wave->progress = (SDL_AtomicAdd(&decode.finished, 1) + 1) / (float)chunkCount;
+		}
+		return 0;
+	};
+
+	const int32_t workerCount = std::min(threadCount, chunkCount);
+	std::vector<SDL_Thread*> threads;
+	threads.reserve(workerCount - 1);
+	for (int32_t i = 0; i < workerCount - 1; i++) {
+		threads.push_back(SDL_CreateThread(worker, "OFS_DecodeMP3", &decode));
+	}
+	// the calling thread helps out
+	worker(&decode);
+	for (auto thread : threads) {
+		SDL_WaitThread(thread, nullptr);
+	}
+	if (cancel) {
+		LOG_INFO("Audio processing cancelled.");
+		return false;
+	}
+
+	size_t lineCount = 0;
+	for (auto& chunk : chunks) lineCount += chunk.lines.Full.size();
+	SamplesLow.reserve(lineCount);
+	SamplesMid.reserve(lineCount);
+	SamplesHigh.reserve(lineCount);
+	SamplesFull.reserve(lineCount);
+	for (auto& chunk : chunks) {
+		SamplesLow.insert(SamplesLow.end(), chunk.lines.Low.begin(), chunk.lines.Low.end());
+		SamplesMid.insert(SamplesMid.end(), chunk.lines.Mid.begin(), chunk.lines.Mid.end());
+		SamplesHigh.insert(SamplesHigh.end(), chunk.lines.High.begin(), chunk.lines.High.end());
+		SamplesFull.insert(SamplesFull.end(), chunk.lines.Full.begin(), chunk.lines.Full.end());
+	}
+	return finalize();
+}
 
-				ctx->wave->SamplesLow.emplace_back(ctx->lowPeak);
-				ctx->wave->SamplesMid.emplace_back(ctx->midPeak);
-				ctx->wave->SamplesHigh.emplace_back(ctx->highPeak);
+bool OFS_Waveform::GenerateFromVideo(const std::string& ffmpegPath, const std::string& videoPath, float durationMs) noexcept
+{
+	OFS_BENCHMARK(__FUNCTION__);
+	generating = true;
+	cancel = false;
+	progress = 0.f;
+	Clear();
+
+	constexpr int32_t SampleRate = 44100;
+	std::array<const char*, 16> args =
+	{
+		ffmpegPath.c_str(),
+		"-loglevel", "error",
+		"-i", videoPath.c_str(),
+		"-vn",
+		"-ac", "1",
+		"-ar", "44100",
+		"-f", "s16le",
+		"-",
+		nullptr
+	};
+
+	reproc::options options;
+	options.redirect.out.type = reproc::redirect::pipe;
+	options.redirect.err.type = reproc::redirect::parent;
+	options.stop = {
+		{ reproc::stop::terminate, reproc::milliseconds(2000) },
+		{ reproc::stop::kill, reproc::infinite },
+	};
+
+	reproc::process process;
+	std::error_code ec = process.start(args.data(), options);
+	if (ec) {
+		LOGF_ERROR("OFS_Waveform::GenerateFromVideo: %s", ec.message().c_str());
+		generating = false;
+		return false;
+	}
+
+	const float expectedSamples = std::max(1.f, (durationMs / 1000.f) * SampleRate);
+	size_t samplesRead = 0;
+
+	WaveformDenormalsScope denormals;
+	WaveformAccumulator ctx;
+	ctx.SetSampleRate(SampleRate);
+	std::array<int16_t, WaveformAccumulator::SamplesPerLine> line;
+	int32_t lineSize = 0;
+
+	// the pipe doesn't care about sample boundaries, an odd byte gets carried over
+	std::vector<uint8_t> buffer(64 * 1024 + 1);
+	size_t carry = 0;
+	while (!cancel) {
+		auto [bytesRead, readEc] = process.read(reproc::stream::out, buffer.data() + carry, buffer.size() - 1 - carry);
+		if (readEc) {
+			// broken_pipe means ffmpeg is done writing
+			if (readEc != std::errc::broken_pipe) {
+				LOGF_ERROR("OFS_Waveform::GenerateFromVideo: %s", readEc.message().c_str());
 			}
+			break;
+		}
 
-			return 0;
-	}, &ctx);
+		size_t available = carry + bytesRead;
+		size_t sampleCount = available / sizeof(int16_t);
+		for (size_t i = 0; i < sampleCount; i++) {
+			int16_t sample;
+			memcpy(&sample, buffer.data() + i * sizeof(int16_t), sizeof(int16_t));
+			line[lineSize++] = sample;
+			if (lineSize == line.size()) {
+				ctx.AddLine(line.data());
+				lineSize = 0;
+			}
+		}
+		carry = available - sampleCount * sizeof(int16_t);
+		if (carry > 0) {
+			buffer[0] = buffer[available - 1];
+		}
+
+		samplesRead += sampleCount;
+		progress = std::min(1.f, samplesRead / expectedSamples);
+	}
+
+	if (cancel) {
+		process.stop(options.stop);
+		Clear();
+		LOG_INFO("Audio processing cancelled.");
+		generating = false;
+		return false;
+	}
+
+	auto [status, waitEc] = process.wait(reproc::infinite);
+	if (waitEc || status != 0) {
+		LOGF_ERROR("OFS_Waveform::GenerateFromVideo: ffmpeg failed. (status: %d)", status);
+		Clear();
+		generating = false;
+		return false;
+	}
+
+	SamplesLow = std::move(ctx.Low);
+	SamplesMid = std::move(ctx.Mid);
+	SamplesHigh = std::move(ctx.High);
+	SamplesFull = std::move(ctx.Full);
+	bool succ = finalize();
+	progress = 1.f;
+	generating = false;
+	return succ;
+}
+
+bool OFS_Waveform::finalize() noexcept
+{
+	if (SamplesFull.empty()) {
+		return false;
+	}
 
 	SamplesLow.shrink_to_fit();
 	SamplesMid.shrink_to_fit();
 	SamplesHigh.shrink_to_fit();
+	SamplesFull.shrink_to_fit();
 
 	auto mapSamples = [](std::vector<float>& samples, float min, float max) noexcept
 	{
@@ -110,37 +555,168 @@ bool OFS_Waveform::LoadMP3(const std::string& path) noexcept
 	MidMax = *midMax;
 
 	auto [highMin, highMax] = std::minmax_element(SamplesHigh.begin(), SamplesHigh.end());
-	float min = std::min(*lowMin, *midMin);	min = std::min(min, *highMin);
-	float max = std::max(*lowMax, *midMax);	max = std::max(max, *highMax);
+	auto [fullMin, fullMax] = std::minmax_element(SamplesFull.begin(), SamplesFull.end());
+	float min = std::min(*lowMin, *midMin);	min = std::min(min, *highMin); min = std::min(min, *fullMin);
+	float max = std::max(*lowMax, *midMax);	max = std::max(max, *highMax); max = std::max(max, *fullMax);
 	mapSamples(SamplesLow, min, max);
 	mapSamples(SamplesMid, min, max);
 	mapSamples(SamplesHigh, min, max);
+	mapSamples(SamplesFull, min, max);
 
 	LowMax = Util::MapRange(LowMax, min, max, 0.f, 1.f);
 	MidMax = Util::MapRange(MidMax, min, max, 0.f, 1.f);
 
-	generating = false;
+	FullLOD.Build(SamplesFull);
 	return true;
 }
 
-bool OFS_Waveform::GenerateMP3(const std::string& ffmpegPath, const std::string& videoPath, const std::string& output) noexcept
+struct WaveformCacheHeader
 {
-	generating = true;
-	reproc::options options;
-	options.redirect.parent = true;
-	std::array<const char*, 10> args =
-	{
-		ffmpegPath.c_str(),
-		"-y",
-		"-i", videoPath.c_str(),
-		"-b:a", "320k",
-		"-ac", "1",
-		output.c_str(),
-		nullptr
+	char magic[4] = { 'O', 'F', 'S', 'W' };
+	uint32_t version = 2;
+	uint64_t sourceSize = 0;
+	int64_t sourceMtime = 0;
+	uint64_t checksum = 0;
+	uint64_t sampleCount = 0;
+	uint64_t levelCount = 0;
+	float lowMax = 0.f;
+	float midMax = 0.f;
+	// followed by levelCount * uint64_t bucket counts
+	// sampleCount floats for low, mid, high & full
+	// and the buckets of every level
+};
+
+static std::string waveformCachePath(const std::string& videoPath) noexcept
+{
+	char name[32];
+	stbsp_snprintf(name, sizeof(name), "%016llx.ofswave", (unsigned long long)Util::Checksum(videoPath.data(), videoPath.size()));
+	return Util::Prefpath(std::string("cache/") + name);
+}
+
+bool OFS_Waveform::LoadCache(const std::string& videoPath) noexcept
+{
+	OFS_BENCHMARK(__FUNCTION__);
+	WaveformCacheHeader expected;
+	if (!Util::FileStat(videoPath, expected.sourceSize, expected.sourceMtime)) return false;
+
+	OFS_MappedFile file;
+	if (!file.Open(waveformCachePath(videoPath)) || file.Size() < sizeof(WaveformCacheHeader)) return false;
+
+	WaveformCacheHeader header;
+	std::memcpy(&header, file.Data(), sizeof(header));
+	if (std::memcmp(header.magic, expected.magic, sizeof(header.magic)) != 0
+		|| header.version != expected.version
+		|| header.sourceSize != expected.sourceSize
+		|| header.sourceMtime != expected.sourceMtime
+		|| header.sampleCount == 0
+		|| header.sampleCount > file.Size() / (4 * sizeof(float))
+		|| header.levelCount > 64) {
+		return false;
+	}
+
+	const uint8_t* data = file.Data() + sizeof(header);
+	std::vector<uint64_t> bucketCounts(header.levelCount);
+	size_t expectedSize = sizeof(header) + header.levelCount * sizeof(uint64_t) + 4 * header.sampleCount * sizeof(float);
+	if (expectedSize > file.Size()) return false;
+	std::memcpy(bucketCounts.data(), data, header.levelCount * sizeof(uint64_t));
+	for (auto count : bucketCounts) {
+		if (count > header.sampleCount) return false;
+		expectedSize += count * sizeof(OFS_WaveformBucket);
+	}
+	if (expectedSize != file.Size()) return false;
+
+	// the checksum is chained over the sections, see WriteCache
+	uint64_t checksum = Util::Checksum(data, header.levelCount * sizeof(uint64_t));
+	const uint8_t* section = data + header.levelCount * sizeof(uint64_t);
+	for (int i = 0; i < 4; i++) {
+		checksum = Util::Checksum(section, header.sampleCount * sizeof(float), checksum);
+		section += header.sampleCount * sizeof(float);
+	}
+	for (auto count : bucketCounts) {
+		checksum = Util::Checksum(section, count * sizeof(OFS_WaveformBucket), checksum);
+		section += count * sizeof(OFS_WaveformBucket);
+	}
+	if (checksum != header.checksum) {
+		LOGF_WARN("Waveform cache for \"%s\" is corrupt.", videoPath.c_str());
+		return false;
+	}
+
+	Clear();
+	data += header.levelCount * sizeof(uint64_t);
+	auto readSamples = [&data, &header](std::vector<float>& samples) noexcept {
+		samples.resize(header.sampleCount);
+		std::memcpy(samples.data(), data, header.sampleCount * sizeof(float));
+		data += header.sampleCount * sizeof(float);
 	};
-	auto[status, ec] = reproc::run(args.data(), options);
+	readSamples(SamplesLow);
+	readSamples(SamplesMid);
+	readSamples(SamplesHigh);
+	readSamples(SamplesFull);
 
-	LOGF_WARN("OFS_Waveform::GenerateMP3: %s", ec.message().c_str());
-	generating = false;
-	return status == 0;
+	FullLOD.Levels.resize(header.levelCount);
+	for (size_t i = 0; i < header.levelCount; i++) {
+		auto& level = FullLOD.Levels[i];
+		level.resize(bucketCounts[i]);
+		std::memcpy(level.data(), data, bucketCounts[i] * sizeof(OFS_WaveformBucket));
+		data += bucketCounts[i] * sizeof(OFS_WaveformBucket);
+	}
+	LowMax = header.lowMax;
+	MidMax = header.midMax;
+	return true;
+}
+
+void OFS_Waveform::WriteCache(const std::string& videoPath) const noexcept
+{
+	OFS_BENCHMARK(__FUNCTION__);
+	if (SampleCount() == 0) return;
+
+	WaveformCacheHeader header;
+	if (!Util::FileStat(videoPath, header.sourceSize, header.sourceMtime)) return;
+	header.sampleCount = SampleCount();
+	header.levelCount = FullLOD.Levels.size();
+	header.lowMax = LowMax;
+	header.midMax = MidMax;
+
+	std::vector<uint64_t> bucketCounts;
+	for (auto& level : FullLOD.Levels) {
+		bucketCounts.push_back(level.size());
+	}
+
+	// everything after the header in the order it gets written
+	std::vector<std::pair<const void*, size_t>> sections;
+	sections.emplace_back(bucketCounts.data(), bucketCounts.size() * sizeof(uint64_t));
+	sections.emplace_back(SamplesLow.data(), SamplesLow.size() * sizeof(float));
+	sections.emplace_back(SamplesMid.data(), SamplesMid.size() * sizeof(float));
+	sections.emplace_back(SamplesHigh.data(), SamplesHigh.size() * sizeof(float));
+	sections.emplace_back(SamplesFull.data(), SamplesFull.size() * sizeof(float));
+	for (auto& level : FullLOD.Levels) {
+		sections.emplace_back(level.data(), level.size() * sizeof(OFS_WaveformBucket));
+	}
+	header.checksum = Util::Checksum(sections[0].first, sections[0].second);
+	for (size_t i = 1; i < sections.size(); i++) {
+		header.checksum = Util::Checksum(sections[i].first, sections[i].second, header.checksum);
+	}
+
+	if (!Util::CreateDirectories(Util::PathFromString(Util::Prefpath("cache")))) return;
+	auto cacheFile = waveformCachePath(videoPath);
+	auto tmpFile = cacheFile + ".tmp";
+	auto handle = Util::OpenFile(tmpFile.c_str(), "wb", tmpFile.size());
+	if (handle == nullptr) {
+		LOGF_ERROR("Failed to write waveform cache: \"%s\"\n%s", cacheFile.c_str(), SDL_GetError());
+		return;
+	}
+	bool failed = SDL_RWwrite(handle, &header, sizeof(header), 1) != 1;
+	for (auto [data, size] : sections) {
+		if (size > 0) failed = failed || SDL_RWwrite(handle, data, size, 1) != 1;
+	}
+	SDL_RWclose(handle);
+
+	std::error_code ec;
+	if (!failed) {
+		std::filesystem::rename(Util::PathFromString(tmpFile), Util::PathFromString(cacheFile), ec);
+	}
+	if (failed || ec) {
+		LOGF_ERROR("Failed to write waveform cache: \"%s\"", cacheFile.c_str());
+		std::filesystem::remove(Util::PathFromString(tmpFile), ec);
+	}
 }
@@ -2,36 +2,97 @@
 
 #include <vector>
 #include <string>
+#include <cstdint>
+#include <atomic>
 
-#include "reproc++/run.hpp"
 
+// min, max & rms of a range of samples
+struct OFS_WaveformBucket
+{
+	float min;
+	float max;
+	float rms;
+};
+
+// mip-style pyramid over a sample array, it's built once after loading
+// every level merges Reduction buckets of the level below, level 0 merges Reduction samples
+// drawing picks the level matching the pixel density so it only touches a few buckets per pixel
+class OFS_WaveformLOD
+{
+public:
+	static constexpr int32_t Reduction = 4;
+	std::vector<std::vector<OFS_WaveformBucket>> Levels;
+
+	void Build(const std::vector<float>& samples) noexcept;
+	inline void Clear() noexcept { Levels.clear(); }
+
+	// writes the peak of every pixel covering the samples [startIdx, endIdx] into output
+	// with less samples than pixels every sample is written as is
+	// samples outside of the array are 0
+	void Resample(const std::vector<float>& samples, int32_t startIdx, int32_t endIdx, int32_t width, std::vector<float>& output) const noexcept;
+};
 
 // helper class to render audio waves
 class OFS_Waveform
 {
 	bool generating = false;
+	std::atomic<bool> cancel = false;
+	std::atomic<float> progress = 0.f;
+
+	// maps the samples into 0-1 & builds the pyramid
+	bool finalize() noexcept;
 public:
 	std::vector<float> SamplesHigh;
 	std::vector<float> SamplesMid;
 	std::vector<float> SamplesLow;
+	// envelope of the unfiltered signal, that's what the timeline draws
+	// the bands split it into below 500Hz, 500-6000Hz & above 6000Hz
+	std::vector<float> SamplesFull;
+
+	OFS_WaveformLOD FullLOD;
 
 	float MidMax = 0.f;
 	float LowMax = 0.f;
 
-	reproc::process GenerateProcess;
-
 	inline bool BusyGenerating() noexcept { return generating; }
+	// 0-1 while decoding
+	inline float Progress() const noexcept { return progress.load(); }
+	// makes GenerateFromVideo & DecodeMP3 stop and return false
+	inline void Cancel() noexcept { cancel = true; }
 
+	// decodes on all cores, used instead of ffmpeg when the opened media is an mp3
 	bool LoadMP3(const std::string& path) noexcept;
-	bool GenerateMP3(const std::string& ffmpegPath, const std::string& videoPath, const std::string& output) noexcept;
+	// the file gets split into chunks at frame boundaries which are decoded on threadCount threads
+	bool DecodeMP3(const uint8_t* data, size_t size, int32_t threadCount) noexcept;
+	// the processed waveform of every video gets cached in the pref dir
+	// an entry is only used while the size & modification time of the video match
+	bool LoadCache(const std::string& videoPath) noexcept;
+	void WriteCache(const std::string& videoPath) const noexcept;
+
+	// streams raw pcm from ffmpeg through a pipe, nothing gets written to disk
+	// durationMs is only used to report progress
+	bool GenerateFromVideo(const std::string& ffmpegPath, const std::string& videoPath, float durationMs) noexcept;
 	
+	// takes over everything a waveform loaded on another thread
+	inline void TakeSamples(OFS_Waveform& other) noexcept {
+		SamplesLow = std::move(other.SamplesLow);
+		SamplesMid = std::move(other.SamplesMid);
+		SamplesHigh = std::move(other.SamplesHigh);
+		SamplesFull = std::move(other.SamplesFull);
+		FullLOD.Levels = std::move(other.FullLOD.Levels);
+		LowMax = other.LowMax;
+		MidMax = other.MidMax;
+	}
+
 	inline void Clear() noexcept {
 		SamplesLow.clear();
 		SamplesMid.clear();
 		SamplesHigh.clear();
+		SamplesFull.clear();
+		FullLOD.Clear();
 	}
 
 	inline size_t SampleCount() const noexcept {
-		return SamplesHigh.size(); // all have the same size
+		return SamplesFull.size(); // all have the same size
 	}
 };
\ No newline at end of file
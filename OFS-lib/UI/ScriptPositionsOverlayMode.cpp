@@ -8,6 +8,7 @@ std::vector<BaseOverlay::ColoredLine> BaseOverlay::ColoredLines;
 std::vector<ImVec2> BaseOverlay::SelectedActionScreenCoordinates;
 std::vector<ImVec2> BaseOverlay::ActionScreenCoordinates;
 std::vector<FunscriptAction> BaseOverlay::ActionPositionWindow;
+std::vector<float> BaseOverlay::SplineSamples;
 bool BaseOverlay::SplineMode = true;
 bool BaseOverlay::ShowActions = true;
 
@@ -142,11 +143,11 @@ void BaseOverlay::DrawActionLines(const OverlayDrawingCtx& ctx) noexcept
             ColoredLines.emplace_back(std::move(BaseOverlay::ColoredLine{ p1, p2, color }));
         }
         else {
-            putPoint(ctx, currentTime);
-            currentTime += timeStep;
-            while (currentTime < endTime) {
-                putPoint(ctx, currentTime);
-                currentTime += timeStep;
+            int32_t count = std::max(1, (int32_t)std::ceil((endTime - currentTime) / timeStep));
+            SplineSamples.resize(count);
+            ctx.script->SamplePositions(currentTime, timeStep, count, SplineSamples.data(), true);
+            for (int32_t i = 0; i < count; i++) {
+                ctx.draw_list->PathLineTo(getPointForTimePos(ctx, currentTime + timeStep * i, SplineSamples[i]));
             }
             putPoint(ctx, endAction.at);
             auto tmpSize = ctx.draw_list->_Path.Size;
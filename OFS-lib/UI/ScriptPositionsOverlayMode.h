@@ -34,6 +34,7 @@ public:
 	static std::vector<FunscriptAction> ActionPositionWindow;
 	static std::vector<ImVec2> SelectedActionScreenCoordinates;
 	static std::vector<ImVec2> ActionScreenCoordinates;
+	static std::vector<float> SplineSamples;
 	static ImGradient speedGradient;
 	// used for calculating stroke color with speedGradient
 	static constexpr float max_speed_per_seconds = 530.f; // arbitrarily choosen maximum tuned for coloring
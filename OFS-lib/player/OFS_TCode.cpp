@@ -17,6 +17,21 @@
 #include "libserialport_internal.h"
 
 #include <chrono>
+#include <array>
+#include <algorithm>
+
+#if WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+#elif defined(__linux__)
+#include <time.h>
+#include <cerrno>
+#else
+#include <thread>
+#endif
 
 // utility structure for realtime plot
 struct ScrollingBuffer {
@@ -106,9 +121,95 @@ void TCodePlayer::save() noexcept
     Util::WriteJson(json, loadPath, true);
 }
 
+// sleeps until absolute deadlines instead of relative delays
+// so the time spent in a tick doesn't add up to drift & no core gets spun
+class TickScheduler
+{
+#if WIN32
+    HANDLE timer = NULL;
+#endif
+public:
+    using Clock = std::chrono::steady_clock;
+
+    TickScheduler() noexcept
+    {
+#if WIN32
+        // high resolution timers exist since windows 10 1803, older versions get the regular one
+        timer = CreateWaitableTimerExW(NULL, NULL, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+        if (timer == NULL) {
+            LOG_WARN("High resolution timer unavailable. T-Code timing will be coarse.");
+            timer = CreateWaitableTimerExW(NULL, NULL, 0, TIMER_ALL_ACCESS);
+        }
+#endif
+    }
+
+    ~TickScheduler() noexcept
+    {
+#if WIN32
+        if (timer != NULL) CloseHandle(timer);
+#endif
+    }
+
+    void SleepUntil(Clock::time_point deadline) noexcept
+    {
+#if WIN32
+        // waitable timers want a relative due time in 100ns units
+        auto remaining = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline - Clock::now()).count();
+        if (remaining <= 0) return;
+        LARGE_INTEGER dueTime;
+        dueTime.QuadPart = -(remaining / 100);
+        if (timer != NULL && SetWaitableTimer(timer, &dueTime, 0, NULL, NULL, FALSE)) {
+            WaitForSingleObject(timer, INFINITE);
+        }
+        else {
+            Sleep(remaining / 1000000);
+        }
+#elif defined(__linux__)
+        // steady_clock is CLOCK_MONOTONIC
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline.time_since_epoch()).count();
+        timespec ts;
+        ts.tv_sec = ns / 1000000000;
+        ts.tv_nsec = ns % 1000000000;
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {}
+#else
+        std::this_thread::sleep_until(deadline);
+#endif
+    }
+};
+
+// how late the thread wakes up after each deadline
+struct TickStats {
+    static constexpr int32_t BucketCount = 8;
+    static constexpr std::array<int32_t, BucketCount - 1> BucketLimitsUs{ 50, 100, 250, 500, 1000, 2000, 5000 };
+    static constexpr std::array<const char*, BucketCount> BucketLabels{ "< 0.05 ms", "< 0.1 ms", "< 0.25 ms", "< 0.5 ms", "< 1 ms", "< 2 ms", "< 5 ms", ">= 5 ms" };
+
+    std::array<SDL_atomic_t, BucketCount> lateness;
+    SDL_atomic_t maxLatenessUs;
+    SDL_atomic_t achievedTickrate; // ticks in the last full second
+    SDL_atomic_t bytesPerSecond; // written to the serial port in the last full second
+
+    inline void Reset() noexcept
+    {
+        for (auto& bucket : lateness) SDL_AtomicSet(&bucket, 0);
+        SDL_AtomicSet(&maxLatenessUs, 0);
+        SDL_AtomicSet(&achievedTickrate, 0);
+        SDL_AtomicSet(&bytesPerSecond, 0);
+    }
+
+    inline void AddLateness(int32_t us) noexcept
+    {
+        int32_t bucket = std::upper_bound(BucketLimitsUs.begin(), BucketLimitsUs.end(), us) - BucketLimitsUs.begin();
+        SDL_AtomicAdd(&lateness[bucket], 1);
+        if (us > SDL_AtomicGet(&maxLatenessUs)) {
+            // only the TCode thread writes this
+            SDL_AtomicSet(&maxLatenessUs, us);
+        }
+    }
+};
+
 static struct TCodeThreadData {
     volatile bool requestStop = false;
-    bool running = false;
+    volatile bool running = false;
     
     SDL_atomic_t scriptTimeMs = { 0 };
     
@@ -117,6 +218,8 @@ static struct TCodeThreadData {
     TCodePlayer* player = nullptr;
     TCodeChannels* channel = nullptr;
     TCodeProducer* producer = nullptr;
+
+    TickStats stats;
 } Thread;
 
 void TCodePlayer::DrawWindow(bool* open, float currentTimeMs) noexcept
@@ -208,11 +311,37 @@ void TCodePlayer::DrawWindow(bool* open, float currentTimeMs) noexcept
     if (ImGui::CollapsingHeader("Global settings"))
     {
         ImGui::InputInt("Delay", &delay, 10, 10); Util::Tooltip("Negative: Backward in time.\nPositive: Forward in time.");
-        ImGui::SliderInt("Tickrate (Hz)", &tickrate, 60, 300, "%d", ImGuiSliderFlags_AlwaysClamp); 
+        ImGui::SliderInt("Tickrate (Hz)", &tickrate, 60, MaxTickrate, "%d", ImGuiSliderFlags_AlwaysClamp); 
         ImGui::Checkbox("Spline", &TCodeChannel::SplineMode);
         Util::Tooltip("Smooth motion instead of linear.");
         ImGui::SameLine(); ImGui::Checkbox("Remap", &TCodeChannel::RemapToFullRange);
         Util::Tooltip("Remap script to use the full range.\ni.e. scripts using the range 10 to 90 become 0 to 100");
+        ImGui::Combo("Output", (int32_t*)&TCodeChannel::OutputMode, "Every tick\0Interval\0");
+        Util::Tooltip("Every tick: Sends the position on every tick.\nInterval: Sends one move per stroke and lets the device interpolate.\nSpline strokes get sent in short chunks.");
+    }
+
+    if (ImGui::CollapsingHeader("Timing"))
+    {
+        auto& stats = Thread.stats;
+        std::array<float, TickStats::BucketCount> buckets;
+        int32_t total = 0;
+        for (int32_t i = 0; i < TickStats::BucketCount; i++) {
+            int32_t count = SDL_AtomicGet(&stats.lateness[i]);
+            buckets[i] = count;
+            total += count;
+        }
+        ImGui::Text("Tickrate: %d / %d Hz", Thread.running ? SDL_AtomicGet(&stats.achievedTickrate) : 0, tickrate);
+        ImGui::Text("Worst wake-up: %.2f ms", SDL_AtomicGet(&stats.maxLatenessUs) / 1000.f);
+        ImGui::Text("Serial: %d bytes/s", Thread.running ? SDL_AtomicGet(&stats.bytesPerSecond) : 0);
+        ImGui::PlotHistogram("##Lateness", buckets.data(), buckets.size(), 0, "Wake-up lateness", 0.f, FLT_MAX, ImVec2(-1.f, 60.f));
+        if (total > 0) {
+            for (int32_t i = 0; i < TickStats::BucketCount; i++) {
+                ImGui::Text("%-10s %5.1f%%", TickStats::BucketLabels[i], 100.f * buckets[i] / total);
+            }
+        }
+        if (ImGui::Button("Reset##TimingStats", ImVec2(-1.f, 0.f))) {
+            stats.Reset();
+        }
     }
 
     ImGui::Spacing(); ImGui::Separator(); ImGui::Spacing();
@@ -259,9 +388,13 @@ void TCodePlayer::DrawWindow(bool* open, float currentTimeMs) noexcept
     
     if (!Thread.running) {
         // move to the current position
+        // looking ahead makes no sense here, the TCode thread isn't running so this is safe
+        auto outputMode = TCodeChannel::OutputMode;
+        TCodeChannel::OutputMode = TCodeOutputMode::PER_TICK;
         int32_t ms = std::round(currentTimeMs);
         prod.sync(ms, 1.f);
         prod.tick(ms, 1.f);
+        TCodeChannel::OutputMode = outputMode;
         const char* cmd = tcode.GetCommandSpeed(500);
         if (cmd != nullptr && port != nullptr) {
             int len = strlen(cmd);
@@ -316,19 +449,27 @@ void TCodePlayer::DrawWindow(bool* open, float currentTimeMs) noexcept
 
 
 static int32_t TCodeThread(void* threadData) noexcept {
+    using Clock = TickScheduler::Clock;
     TCodeThreadData* data = (TCodeThreadData*)threadData;
 
     LOG_INFO("T-Code thread started...");
-    auto startTime = std::chrono::high_resolution_clock::now();
+    TickScheduler scheduler;
+    auto startTime = Clock::now();
     
     int scriptTimeMs = 0;
 
     data->producer->sync(SDL_AtomicGet(&data->scriptTimeMs), data->player->tickrate);
+    data->stats.Reset();
+
+    int32_t scheduledTickrate = 0;
+    Clock::time_point deadline;
+    Clock::time_point statsStart = startTime;
+    int32_t statsTicks = 0;
+    int32_t statsBytes = 0;
 
     while (!data->requestStop) {
-        float tickrate = data->player->tickrate;
-        float tickDurationSeconds = 1.f / tickrate;
-        auto currentTime = std::chrono::high_resolution_clock::now();
+        int32_t tickrate = Util::Clamp(data->player->tickrate, 1, TCodePlayer::MaxTickrate);
+        auto currentTime = Clock::now();
 
         int32_t delay = data->player->delay;
         int32_t data_scriptTimeMs = SDL_AtomicGet(&data->scriptTimeMs);
@@ -342,7 +483,7 @@ static int32_t TCodeThread(void* threadData) noexcept {
             LOGF_INFO("prev: %d new: %d", currentTimeMs, syncTimeMs);
 
             scriptTimeMs = data_scriptTimeMs;
-            startTime = std::move(currentTime);
+            startTime = currentTime;
             currentTimeMs = syncTimeMs;
 
             data->producer->sync(currentTimeMs, tickrate);
@@ -360,17 +501,41 @@ static int32_t TCodeThread(void* threadData) noexcept {
             if (sp_blocking_write(data->player->port, cmd, len, 0) < SP_OK) {
                 LOG_ERROR("Failed to write to serial port.");
             }
+            statsBytes += len;
+        }
+
+        // deadlines are absolute, time spent in the tick is already accounted for
+        const auto tickDuration = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / tickrate));
+        if (tickrate != scheduledTickrate) {
+            scheduledTickrate = tickrate;
+            deadline = currentTime;
+        }
+        deadline += tickDuration;
+        auto now = Clock::now();
+        if (now - deadline >= tickDuration) {
+            // more than a tick behind, skip ahead instead of catching up with a burst of writes
+            // the lateness still gets recorded otherwise the histogram hides the worst ticks
+            data->stats.AddLateness(std::chrono::duration_cast<std::chrono::microseconds>(now - deadline).count());
+            deadline = now;
+        }
+        else {
+            scheduler.SleepUntil(deadline);
+            now = Clock::now();
+            data->stats.AddLateness(std::chrono::duration_cast<std::chrono::microseconds>(now - deadline).count());
         }
 
-        while((duration = std::chrono::high_resolution_clock::now() - currentTime).count() < tickDurationSeconds) {
-            /* Spin wait */
-            OFS_PAUSE_INTRIN();
-            int ms = (duration.count() / 0.001f) - 1;
-            if (ms > 0) { SDL_Delay(ms); }
+        statsTicks++;
+        if (now - statsStart >= std::chrono::seconds(1)) {
+            std::chrono::duration<float> elapsed = now - statsStart;
+            SDL_AtomicSet(&data->stats.achievedTickrate, std::round(statsTicks / elapsed.count()));
+            SDL_AtomicSet(&data->stats.bytesPerSecond, std::round(statsBytes / elapsed.count()));
+            statsStart = now;
+            statsTicks = 0;
+            statsBytes = 0;
         }
     } 
-    data->running = false;
     data->requestStop = false;
+    data->running = false;
     LOG_INFO("T-Code thread stopped.");
 
     return 0;
@@ -430,7 +595,7 @@ void TCodePlayer::stop() noexcept
 {
     if (Thread.running) {
         Thread.requestStop = true;
-        while (!Thread.running) { SDL_Delay(1); }
+        while (Thread.running) { SDL_Delay(1); }
     }
 }
 
@@ -442,9 +607,6 @@ void TCodePlayer::sync(float currentTimeMs, float speed) noexcept
 
 void TCodePlayer::reset() noexcept
 {
-    if (Thread.running) {
-        Thread.requestStop = true;
-        while (!Thread.running) { SDL_Delay(1); }
-    }
+    stop();
     prod.ClearChannels();
 }
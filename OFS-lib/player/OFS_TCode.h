@@ -14,6 +14,7 @@ public:
 	struct sp_port** port_list = nullptr;
 	struct sp_port* port = nullptr;
 
+	static constexpr int32_t MaxTickrate = 1000;
 	int32_t tickrate = 250;
 	int32_t delay = 0;
 
@@ -43,5 +44,7 @@ public:
 		OFS_REFLECT(delay, ar);
 		OFS_REFLECT_NAMED("SplineMode", TCodeChannel::SplineMode, ar);
 		OFS_REFLECT_NAMED("RemapToFullRange", TCodeChannel::RemapToFullRange, ar);
+		OFS_REFLECT_NAMED("OutputMode", TCodeChannel::OutputMode, ar);
+		TCodeChannel::OutputMode = (TCodeOutputMode)Util::Clamp<int32_t>(TCodeChannel::OutputMode, TCodeOutputMode::PER_TICK, TCodeOutputMode::TOTAL_NUM_OUTPUT_MODES - 1);
 	}
 };
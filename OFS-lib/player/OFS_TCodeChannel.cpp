@@ -2,6 +2,7 @@
 
 bool TCodeChannel::SplineMode = false;
 bool TCodeChannel::RemapToFullRange = false;
+TCodeOutputMode TCodeChannel::OutputMode = TCodeOutputMode::PER_TICK;
 
 std::array<const std::vector<const char*>, static_cast<size_t>(TChannel::TotalCount)> TCodeChannels::Aliases
 {
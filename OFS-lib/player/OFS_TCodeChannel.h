@@ -7,12 +7,19 @@
 #include <array>
 #include <sstream>
 
+enum TCodeOutputMode : int32_t {
+	PER_TICK, // absolute position every tick
+	INTERVAL, // one move per stroke with an I<ms> suffix, the device interpolates
+	TOTAL_NUM_OUTPUT_MODES
+};
+
 class TCodeChannel {
 public:
 	// 2 characters + 0 terminator
 	char Id[3] = "\0";
 	int32_t LastTCodeValue = -1;
 	int32_t NextTCodeValue = -1;
+	int32_t NextIntervalMs = 0; // 0 means no interval
 
 	char LastCommand[16] = "?????\0";
 
@@ -22,6 +29,7 @@ public:
 	
 	static bool SplineMode;
 	static bool RemapToFullRange;
+	static TCodeOutputMode OutputMode;
 
 	bool Enabled = true;
 	bool Rebalance = false;
@@ -56,11 +64,25 @@ public:
 		if (std::isnan(relativePos)) return;
 		if (Invert) { relativePos = glm::abs(relativePos - 1.f); }
 		NextTCodeValue = GetPos(relativePos);
+		NextIntervalMs = 0;
+	}
+
+	// the device moves to relativePos over intervalMs on its own
+	inline void SetNextMove(float relativePos, int32_t intervalMs) noexcept
+	{
+		if (std::isnan(relativePos)) return;
+		SetNextPos(relativePos);
+		NextIntervalMs = intervalMs;
 	}
 
 	inline const char* getCommand() noexcept {
 		if (Enabled && NextTCodeValue != LastTCodeValue) {
-			stbsp_snprintf(LastCommand, sizeof(LastCommand), "%s%d", Id, NextTCodeValue);
+			if (NextIntervalMs > 0) {
+				stbsp_snprintf(LastCommand, sizeof(LastCommand), "%s%dI%d", Id, NextTCodeValue, NextIntervalMs);
+			}
+			else {
+				stbsp_snprintf(LastCommand, sizeof(LastCommand), "%s%d", Id, NextTCodeValue);
+			}
 			LastTCodeValue = NextTCodeValue;
 			return LastCommand;
 		}
@@ -80,6 +102,7 @@ public:
 	inline void reset() noexcept {
 		LastTCodeValue = 499;
 		NextTCodeValue = 500;
+		NextIntervalMs = 0;
 	}
 
 	template <class Archive>
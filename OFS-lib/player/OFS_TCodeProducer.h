@@ -43,23 +43,26 @@ private:
 		nextAction.pos = Util::MapRange<float>(nextAction.pos, ScriptMinPos, ScriptMaxPos, 0.f, 100.f);
 	}
 
-	inline float getPos(int32_t currentTimeMs, float freq) noexcept {
-		if (currentTimeMs > nextAction.at) { return LastValue; }
-
-		float progress = Util::Clamp((float)(currentTimeMs - startAction.at) / (nextAction.at - startAction.at), 0.f, 1.f);
-		
-
+	// position of the current stroke at timeMs from 0 to 1
+	inline float scriptPos(int32_t timeMs) noexcept {
 		float pos;
-		std::shared_ptr<const Funscript> ptr;
-		if (TCodeChannel::SplineMode && GetScript(ptr))
+		if (TCodeChannel::SplineMode && actions != nullptr)
 		{
-			pos = ptr->ScriptSpline.SampleAtIndex(ptr->Actions(), currentIndex, currentTimeMs);
+			pos = FunscriptSpline::SampleAtIndex(*actions, currentIndex, timeMs);
 			if (TCodeChannel::RemapToFullRange) { pos = Util::MapRange<float>(pos, ScriptMinPos / 100.f, ScriptMaxPos / 100.f, 0.f, 1.f); }
 		}
 		else
 		{
+			float progress = Util::Clamp((float)(timeMs - startAction.at) / (nextAction.at - startAction.at), 0.f, 1.f);
 			pos = Util::Lerp<float>(startAction.pos / 100.f, nextAction.pos / 100.f, progress);
 		}
+		return pos;
+	}
+
+	inline float getPos(int32_t currentTimeMs, float freq) noexcept {
+		if (currentTimeMs > nextAction.at) { return LastValue; }
+
+		float pos = scriptPos(currentTimeMs);
 
 		RawSpeed = std::abs(pos - LastValue) / (1.f/freq);
 
@@ -90,8 +93,26 @@ private:
 		return LastValue;
 	}
 
+	// interval mode sends a move to the end of the stroke and lets the device interpolate
+	// splines get split into chunks, a single move would flatten the curve
+	static constexpr int32_t SplineChunkMs = 100;
+	int32_t moveEndMs = 0;
+
+	inline void queueMove(int32_t currentTimeMs) noexcept {
+		int32_t endMs = nextAction.at;
+		if (TCodeChannel::SplineMode) { endMs = std::min(endMs, currentTimeMs + SplineChunkMs); }
+		if (endMs <= currentTimeMs) return;
+
+		LastValue = scriptPos(endMs);
+		moveEndMs = endMs;
+		channel->SetNextMove(LastValue, endMs - currentTimeMs);
+	}
+
 	int32_t currentIndex = 0;
 	int32_t scriptIndex = -1;
+
+	// the snapshot which is being played, only touched by whoever drives the producer
+	std::shared_ptr<const std::vector<FunscriptAction>> actions;
 	
 	inline bool GetScript(std::shared_ptr<const Funscript>& ptr) noexcept
 	{
@@ -103,6 +124,20 @@ private:
 		ptr = nullptr;
 		return false;
 	}
+
+	// picks up the latest snapshot of the script
+	// the indices into the old snapshot are meaningless after an edit so it resyncs
+	inline bool acquireSnapshot() noexcept
+	{
+		std::shared_ptr<const Funscript> scriptPtr;
+		if (!GetScript(scriptPtr)) { actions = nullptr; return false; }
+		auto snapshot = scriptPtr->ActionSnapshot();
+		if (snapshot != actions) {
+			actions = std::move(snapshot);
+			NeedsResync = true;
+		}
+		return actions != nullptr && actions->size() > 1;
+	}
 public:
 	std::vector<std::weak_ptr<const Funscript>>* scripts = nullptr;
 	TCodeChannel* channel = nullptr;
@@ -139,12 +174,13 @@ public:
 	}
 
 	inline void sync(int32_t CurrentTimeMs, float freq) noexcept {
-		std::shared_ptr<const Funscript> scriptPtr;
 		if (channel == nullptr || scripts == nullptr) return;
-		if (!GetScript(scriptPtr)) return;
+		if (!acquireSnapshot()) return;
 		// TODO: check if out of sync first
 
-		auto& actions = scriptPtr->Actions();
+		auto& actions = *this->actions;
+		// the snapshot may have gotten shorter
+		currentIndex = std::min<int32_t>(currentIndex, actions.size() - 2);
 
 		for (int i = 0; i < actions.size(); i++) {
 			auto action = actions[i];
@@ -158,9 +194,13 @@ public:
 			}
 		}
 
+		NeedsResync = false;
+		if (TCodeChannel::OutputMode == TCodeOutputMode::INTERVAL) {
+			queueMove(CurrentTimeMs);
+			return;
+		}
 		float interp = getPos(CurrentTimeMs, freq);
 		channel->SetNextPos(interp);
-		NeedsResync = false;
 	}
 
 #ifndef NDEBUG
@@ -168,19 +208,20 @@ public:
 #endif
 
 	inline void tick(int32_t CurrentTimeMs, float freq) noexcept {
-		std::shared_ptr<const Funscript> scriptPtr;
 		if (scripts == nullptr || channel == nullptr) return;
-		if (!GetScript(scriptPtr)) return;
+		if (!acquireSnapshot()) return;
 
 		if (NeedsResync) { sync(CurrentTimeMs, freq); }
-		auto& actions = scriptPtr->Actions();
+		auto& actions = *this->actions;
 
 		int newIndex = currentIndex;
 		if (CurrentTimeMs > nextAction.at) {
 			newIndex++;
 		}
 
+		bool newStroke = false;
 		if (currentIndex != newIndex && newIndex < actions.size()) {
+			newStroke = true;
 #ifndef NDEBUG
 			if (foo && newIndex-currentIndex <= -1) {
 				FUN_ASSERT(false, "bug???");
@@ -204,6 +245,11 @@ public:
 			foo = false;
 		}
 #endif
+		if (TCodeChannel::OutputMode == TCodeOutputMode::INTERVAL) {
+			// only talk to the device when the previous move is done or a new stroke started
+			if (newStroke || CurrentTimeMs >= moveEndMs) { queueMove(CurrentTimeMs); }
+			return;
+		}
 		float interp = getPos(CurrentTimeMs, freq);
 		channel->SetNextPos(interp);
 	}
@@ -0,0 +1,63 @@
+#include "OFS_BenchmarkRunner.h"
+
+#include "Funscript.h"
+
+// pastes 50k actions into a 200k action script
+OFS_REGISTER_BENCHMARK(FunscriptBatchEdit)
+{
+	constexpr int32_t ScriptSize = 200000;
+	constexpr int32_t PasteSize = 50000;
+
+	auto base = OFS_BenchmarkRunner::GenerateActions(ScriptSize, 1);
+	auto paste = OFS_BenchmarkRunner::GenerateActions(PasteSize, 2);
+	// spread the pasted actions over the whole script without hitting existing timestamps
+	for (auto& action : base) action.at *= 2;
+	const float stretch = base.back().at / (float)paste.back().at;
+	for (auto& action : paste) action.at = (int32_t)(action.at * stretch) | 1;
+
+	float ms;
+	size_t resultSize = 0;
+
+	// how it used to be done: linear insert per action followed by a full sort in update()
+	ms = OFS_BenchmarkRunner::Measure(1, [&](int32_t) {
+		auto actions = base;
+		for (auto newAction : paste) {
+			auto it = std::find_if(actions.begin(), actions.end(), [&](auto& action) {
+				return newAction.at < action.at;
+			});
+			actions.insert(it, newAction);
+		}
+		std::sort(actions.begin(), actions.end(),
+			[](auto& a, auto& b) { return a.at < b.at; }
+		);
+		resultSize = actions.size();
+	});
+	OFS_BenchmarkRunner::Report("linear insert + sort", ms, PasteSize);
+
+	{
+		Funscript script;
+		script.SetActions(base);
+		ms = OFS_BenchmarkRunner::Measure(1, [&](int32_t) {
+			for (auto action : paste) {
+				script.PasteAction(action, 0);
+			}
+		});
+		OFS_BenchmarkRunner::Report("PasteAction (binary insert)", ms, PasteSize);
+	}
+
+	{
+		Funscript script;
+		script.SetActions(base);
+		ms = OFS_BenchmarkRunner::Measure(1, [&](int32_t) {
+			script.BeginBatchEdit();
+			for (auto action : paste) {
+				script.PasteAction(action, 0);
+			}
+			script.CommitBatchEdit();
+		});
+		OFS_BenchmarkRunner::Report("PasteAction (batch edit)", ms, PasteSize);
+		if (script.Actions().size() != resultSize || !OFS::search::IsSorted(script.Actions())) {
+			LOGF_ERROR("Batch edit result doesn't match. %zu vs %zu", script.Actions().size(), resultSize);
+		}
+	}
+}
@@ -0,0 +1,52 @@
+#include "OFS_BenchmarkRunner.h"
+
+#include "FunscriptHeatmap.h"
+
+// a full update is what used to happen on every edit
+// the local edit moves a single action in the middle of a script without any gaps
+// so it only gets faster because of the per kernel checkpoints
+OFS_REGISTER_BENCHMARK(FunscriptHeatmap)
+{
+	constexpr int32_t ActionCount = 200000;
+	constexpr int32_t Edits = 100;
+
+	auto actions = OFS_BenchmarkRunner::GenerateActions(ActionCount);
+	float totalDurationMs = actions.back().at + 1000.f;
+	auto original = std::make_shared<const std::vector<FunscriptAction>>(actions);
+	actions[ActionCount / 2].pos = (actions[ActionCount / 2].pos + 50) % 101;
+	auto edited = std::make_shared<const std::vector<FunscriptAction>>(actions);
+
+	float ms = OFS_BenchmarkRunner::Measure(Edits, [&](int32_t) {
+		OFS::HeatmapBuilder builder;
+		builder.Update(original);
+		OFS_BenchmarkRunner::Sink += builder.Marks().size();
+	});
+	OFS_BenchmarkRunner::Report("full update", ms, Edits);
+
+	// flips between the two snapshots, every update is a single changed action
+	OFS::HeatmapBuilder builder;
+	builder.Update(original);
+	ms = OFS_BenchmarkRunner::Measure(Edits, [&](int32_t i) {
+		builder.Update(i % 2 == 0 ? edited : original);
+		OFS_BenchmarkRunner::Sink += builder.Marks().size();
+	});
+	OFS_BenchmarkRunner::Report("local edit (gapless)", ms, Edits);
+
+	builder.Update(edited);
+	OFS::HeatmapBuilder fresh;
+	fresh.Update(edited);
+	auto& a = builder.Marks();
+	auto& b = fresh.Marks();
+	if (a.size() != b.size() || !std::equal(a.begin(), a.end(), b.begin(), [](auto& x, auto& y) {
+		return x.timeMs == y.timeMs && x.color.Value.x == y.color.Value.x && x.color.Value.y == y.color.Value.y
+			&& x.color.Value.z == y.color.Value.z && x.color.Value.w == y.color.Value.w;
+	})) {
+		LOG_ERROR("The incremental heatmap doesn't match a full update!");
+	}
+
+	ImGradient gradient;
+	ms = OFS_BenchmarkRunner::Measure(Edits, [&](int32_t) {
+		builder.BuildGradient(totalDurationMs, gradient);
+	});
+	OFS_BenchmarkRunner::Report("build gradient", ms, Edits);
+}
@@ -0,0 +1,84 @@
+#include "OFS_BenchmarkRunner.h"
+
+#include "Funscript.h"
+#include "FunscriptIO.h"
+
+#include <set>
+#include <filesystem>
+
+// parses a 20MB-ish funscript from memory
+OFS_REGISTER_BENCHMARK(FunscriptLoad)
+{
+	constexpr int32_t ActionCount = 1000000;
+
+	nlohmann::json json;
+	json["version"] = "1.0";
+	json["inverted"] = false;
+	json["range"] = 100;
+	json["metadata"] = { { "title", "benchmark" } };
+	json["some_other_tool"] = { { "keep", "me" } };
+	auto& actionsJson = json["actions"];
+	for (auto action : OFS_BenchmarkRunner::GenerateActions(ActionCount)) {
+		actionsJson.push_back({ { "at", action.at }, { "pos", action.pos } });
+	}
+	const std::string text = json.dump();
+	json = nlohmann::json();
+	LOGF_INFO("%-40s %.2f MB", "funscript size", text.size() / (1024.f * 1024.f));
+
+	float ms;
+	std::vector<FunscriptAction> oldActions;
+	// how it used to be done: full dom, copy of the actions array & std::set
+	ms = OFS_BenchmarkRunner::Measure(1, [&](int32_t) {
+		auto dom = nlohmann::json::parse(text, nullptr, false, true);
+		auto actions = dom["actions"];
+		std::set<FunscriptAction> actionSet;
+		for (auto& action : actions) {
+			int32_t time_ms = action["at"];
+			int32_t pos = action["pos"];
+			if (time_ms >= 0) {
+				actionSet.emplace(time_ms, pos);
+			}
+		}
+		oldActions.assign(actionSet.begin(), actionSet.end());
+	});
+	OFS_BenchmarkRunner::Report("dom + std::set", ms, ActionCount);
+
+	std::vector<FunscriptAction> newActions;
+	nlohmann::json rest;
+	ms = OFS_BenchmarkRunner::Measure(1, [&](int32_t) {
+		OFS::io::ParseFunscript(text.data(), text.size(), newActions, rest);
+	});
+	OFS_BenchmarkRunner::Report("sax ParseFunscript", ms, ActionCount);
+
+	if (oldActions.size() != newActions.size()
+		|| !std::equal(oldActions.begin(), oldActions.end(), newActions.begin())
+		|| !rest.contains("some_other_tool") || rest.contains("actions")) {
+		LOG_ERROR("ParseFunscript doesn't match the old loader!");
+	}
+
+	// reopening the same file with the binary cache
+	// the cache goes into a temp dir as well, the real one is left alone
+	const auto tempDir = std::filesystem::temp_directory_path() / "ofs_benchmark_load";
+	std::error_code ec;
+	std::filesystem::create_directories(tempDir, ec);
+	const std::string path = (tempDir / "benchmark.funscript").u8string();
+	const std::string prevCacheDir = OFS::io::FunscriptCacheDir;
+	OFS::io::FunscriptCacheDir = (tempDir / "cache").u8string();
+	OFS::io::WriteFunscript(path, newActions, rest);
+	ms = OFS_BenchmarkRunner::Measure(1, [&](int32_t) {
+		OFS::io::LoadFunscriptCached(path, newActions, rest);
+	});
+	OFS_BenchmarkRunner::Report("LoadFunscriptCached (cold)", ms, ActionCount);
+	ms = OFS_BenchmarkRunner::Measure(1, [&](int32_t) {
+		if (!OFS::io::LoadFunscriptCached(path, newActions, rest)) {
+			LOG_ERROR("Failed to load from cache!");
+		}
+	});
+	OFS_BenchmarkRunner::Report("LoadFunscriptCached (warm)", ms, ActionCount);
+	if (oldActions.size() != newActions.size()
+		|| !std::equal(oldActions.begin(), oldActions.end(), newActions.begin())) {
+		LOG_ERROR("Cached actions don't match!");
+	}
+	OFS::io::FunscriptCacheDir = prevCacheDir;
+	std::filesystem::remove_all(tempDir, ec);
+}
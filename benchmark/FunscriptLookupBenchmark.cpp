@@ -0,0 +1,145 @@
+#include "OFS_BenchmarkRunner.h"
+
+#include "Funscript.h"
+
+#include <random>
+#include <limits>
+
+// the linear lookups Funscript used before switching to binary search
+namespace Linear
+{
+	static const FunscriptAction* getActionAtTime(const std::vector<FunscriptAction>& actions, int32_t time_ms, uint32_t max_error_ms) noexcept
+	{
+		int32_t smallest_error = std::numeric_limits<int32_t>::max();
+		const FunscriptAction* smallest_error_action = nullptr;
+
+		for (int i = 0; i < actions.size(); i++) {
+			auto& action = actions[i];
+
+			if (action.at > (time_ms + (max_error_ms / 2)))
+				break;
+
+			int32_t error = std::abs(time_ms - action.at);
+			if (error <= max_error_ms) {
+				if (error <= smallest_error) {
+					smallest_error = error;
+					smallest_error_action = &action;
+				}
+				else {
+					break;
+				}
+			}
+		}
+		return smallest_error_action;
+	}
+
+	static const FunscriptAction* getNextActionAhead(const std::vector<FunscriptAction>& actions, int32_t time_ms) noexcept
+	{
+		auto it = std::find_if(actions.begin(), actions.end(),
+			[&](auto& action) {
+				return action.at > time_ms;
+			});
+		return it != actions.end() ? &(*it) : nullptr;
+	}
+
+	static const FunscriptAction* getPreviousActionBehind(const std::vector<FunscriptAction>& actions, int32_t time_ms) noexcept
+	{
+		auto it = std::find_if(actions.rbegin(), actions.rend(),
+			[&](auto& action) {
+				return action.at < time_ms;
+			});
+		return it != actions.rend() ? &(*it) : nullptr;
+	}
+
+	static float GetPositionAtTime(const std::vector<FunscriptAction>& actions, int32_t time_ms) noexcept
+	{
+		if (actions.size() == 0) { return 0; }
+		else if (actions.size() == 1) return actions[0].pos;
+
+		for (int i = 0; i < actions.size() - 1; i++) {
+			auto& action = actions[i];
+			auto& next = actions[i + 1];
+
+			if (time_ms > action.at && time_ms < next.at) {
+				float progress = (float)(time_ms - action.at) / (next.at - action.at);
+				return action.pos + (progress * (float)(next.pos - action.pos));
+			}
+			else if (action.at == time_ms) {
+				return action.pos;
+			}
+		}
+		return actions.back().pos;
+	}
+}
+
+OFS_REGISTER_BENCHMARK(FunscriptLookup)
+{
+	constexpr int32_t ActionCount = 1000000;
+	constexpr int32_t LinearQueries = 200;
+	constexpr int32_t BinaryQueries = 1000000;
+
+	Funscript script;
+	script.SetActions(OFS_BenchmarkRunner::GenerateActions(ActionCount));
+	auto& actions = script.Actions();
+	const int32_t totalMs = actions.back().at + 1000;
+
+	std::mt19937 rng(42);
+	std::uniform_int_distribution<int32_t> timeDist(-1000, totalMs);
+	std::vector<int32_t> queries(BinaryQueries);
+	for (auto& q : queries) q = timeDist(rng);
+
+	// make sure both implementations agree before timing anything
+	int32_t mismatches = 0;
+	for (int32_t i = 0; i < 2000; i++) {
+		int32_t t = queries[i];
+		if (Linear::getActionAtTime(actions, t, 20) != script.GetActionAtTime(t, 20)) mismatches++;
+		if (Linear::getNextActionAhead(actions, t) != script.GetNextActionAhead(t)) mismatches++;
+		if (Linear::getPreviousActionBehind(actions, t) != script.GetPreviousActionBehind(t)) mismatches++;
+		if (Linear::GetPositionAtTime(actions, t) != script.GetPositionAtTime(t)) mismatches++;
+	}
+	if (mismatches > 0) {
+		LOGF_ERROR("Linear and binary search disagree %d times!", mismatches);
+	}
+
+	float ms;
+	ms = OFS_BenchmarkRunner::Measure(LinearQueries, [&](int32_t i) {
+		OFS_BenchmarkRunner::Sink += (intptr_t)Linear::getActionAtTime(actions, queries[i], 20);
+	});
+	OFS_BenchmarkRunner::Report("linear getActionAtTime", ms, LinearQueries);
+	ms = OFS_BenchmarkRunner::Measure(BinaryQueries, [&](int32_t i) {
+		OFS_BenchmarkRunner::Sink += (intptr_t)script.GetActionAtTime(queries[i], 20);
+	});
+	OFS_BenchmarkRunner::Report("binary GetActionAtTime", ms, BinaryQueries);
+
+	ms = OFS_BenchmarkRunner::Measure(LinearQueries, [&](int32_t i) {
+		OFS_BenchmarkRunner::Sink += (intptr_t)Linear::getNextActionAhead(actions, queries[i]);
+	});
+	OFS_BenchmarkRunner::Report("linear getNextActionAhead", ms, LinearQueries);
+	ms = OFS_BenchmarkRunner::Measure(BinaryQueries, [&](int32_t i) {
+		OFS_BenchmarkRunner::Sink += (intptr_t)script.GetNextActionAhead(queries[i]);
+	});
+	OFS_BenchmarkRunner::Report("binary GetNextActionAhead", ms, BinaryQueries);
+
+	ms = OFS_BenchmarkRunner::Measure(LinearQueries, [&](int32_t i) {
+		OFS_BenchmarkRunner::Sink += (intptr_t)Linear::getPreviousActionBehind(actions, queries[i]);
+	});
+	OFS_BenchmarkRunner::Report("linear getPreviousActionBehind", ms, LinearQueries);
+	ms = OFS_BenchmarkRunner::Measure(BinaryQueries, [&](int32_t i) {
+		OFS_BenchmarkRunner::Sink += (intptr_t)script.GetPreviousActionBehind(queries[i]);
+	});
+	OFS_BenchmarkRunner::Report("binary GetPreviousActionBehind", ms, BinaryQueries);
+
+	ms = OFS_BenchmarkRunner::Measure(LinearQueries, [&](int32_t i) {
+		OFS_BenchmarkRunner::Sink += (int64_t)Linear::GetPositionAtTime(actions, queries[i]);
+	});
+	OFS_BenchmarkRunner::Report("linear GetPositionAtTime", ms, LinearQueries);
+	ms = OFS_BenchmarkRunner::Measure(BinaryQueries, [&](int32_t i) {
+		OFS_BenchmarkRunner::Sink += (int64_t)script.GetPositionAtTime(queries[i]);
+	});
+	OFS_BenchmarkRunner::Report("binary GetPositionAtTime", ms, BinaryQueries);
+
+	ms = OFS_BenchmarkRunner::Measure(BinaryQueries, [&](int32_t i) {
+		OFS_BenchmarkRunner::Sink += (intptr_t)script.GetAction(actions[i % actions.size()]);
+	});
+	OFS_BenchmarkRunner::Report("binary GetAction", ms, BinaryQueries);
+}
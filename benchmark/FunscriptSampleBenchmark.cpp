@@ -0,0 +1,76 @@
+#include "OFS_BenchmarkRunner.h"
+
+#include "Funscript.h"
+
+#include <random>
+#include <cmath>
+
+static void reportThroughput(const char* name, float ms, int64_t samples) noexcept
+{
+	OFS_BenchmarkRunner::Report(name, ms, samples);
+	LOGF_INFO("%-40s %10.1f Msamples/s", name, ms > 0.f ? samples / (ms * 1000.0) : 0.0);
+}
+
+// sampling one timestamp at a time vs filling a buffer in one call
+// the step is about what the timeline uses when zoomed in on a couple of strokes
+OFS_REGISTER_BENCHMARK(FunscriptSample)
+{
+	constexpr int32_t ActionCount = 200000;
+	constexpr int32_t SampleCount = 2000000;
+	constexpr float StepMs = 5.f;
+
+	Funscript script;
+	script.SetActions(OFS_BenchmarkRunner::GenerateActions(ActionCount));
+	const float t0 = -1000.f;
+
+	std::vector<float> out(SampleCount);
+	std::vector<float> sortedTimes(SampleCount);
+	std::mt19937 rng(42);
+	std::uniform_real_distribution<float> gap(0.f, 2.f * StepMs);
+	float t = t0;
+	for (auto& time : sortedTimes) { time = t; t += gap(rng); }
+
+	// make sure the batch results agree with the single sample versions
+	int32_t mismatches = 0;
+	script.SamplePositions(t0, StepMs, SampleCount, out.data(), true);
+	for (int32_t i = 0; i < SampleCount; i += 97) {
+		if (std::abs(out[i] - script.SplineClamped(t0 + StepMs * i)) > 0.001f) mismatches++;
+	}
+	script.SamplePositions(sortedTimes.data(), SampleCount, out.data(), true);
+	for (int32_t i = 0; i < SampleCount; i += 97) {
+		if (std::abs(out[i] - script.SplineClamped(sortedTimes[i])) > 0.001f) mismatches++;
+	}
+	// GetPositionAtTime returns the last position in front of the script, so start at the first action
+	const int32_t firstMs = script.Actions().front().at;
+	script.SamplePositions(firstMs, 1.f, SampleCount, out.data(), false);
+	for (int32_t i = 0; i < SampleCount; i += 97) {
+		if (std::abs(out[i] - script.GetPositionAtTime(firstMs + i)) > 0.001f) mismatches++;
+	}
+	if (mismatches > 0) {
+		LOGF_ERROR("Batch and single sampling disagree %d times!", mismatches);
+	}
+
+	float ms;
+	ms = OFS_BenchmarkRunner::Measure(SampleCount, [&](int32_t i) {
+		out[i] = script.SplineClamped(t0 + StepMs * i);
+	});
+	reportThroughput("single spline", ms, SampleCount);
+	ms = OFS_BenchmarkRunner::Measure(1, [&](int32_t) {
+		script.SamplePositions(t0, StepMs, SampleCount, out.data(), true);
+	});
+	reportThroughput("batch spline", ms, SampleCount);
+	ms = OFS_BenchmarkRunner::Measure(1, [&](int32_t) {
+		script.SamplePositions(sortedTimes.data(), SampleCount, out.data(), true);
+	});
+	reportThroughput("batch spline sorted times", ms, SampleCount);
+
+	ms = OFS_BenchmarkRunner::Measure(SampleCount, [&](int32_t i) {
+		out[i] = script.GetPositionAtTime(t0 + StepMs * i);
+	});
+	reportThroughput("single linear", ms, SampleCount);
+	ms = OFS_BenchmarkRunner::Measure(1, [&](int32_t) {
+		script.SamplePositions(t0, StepMs, SampleCount, out.data(), false);
+	});
+	reportThroughput("batch linear", ms, SampleCount);
+	OFS_BenchmarkRunner::Sink += (int64_t)out[SampleCount / 2];
+}
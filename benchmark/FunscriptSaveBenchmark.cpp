@@ -0,0 +1,49 @@
+#include "OFS_BenchmarkRunner.h"
+
+#include "Funscript.h"
+#include "FunscriptIO.h"
+
+#include <filesystem>
+
+OFS_REGISTER_BENCHMARK(FunscriptSave)
+{
+	constexpr int32_t ActionCount = 1000000;
+
+	auto actions = OFS_BenchmarkRunner::GenerateActions(ActionCount);
+	nlohmann::json base;
+	base["version"] = "1.0";
+	base["inverted"] = false;
+	base["range"] = 100;
+	base["metadata"] = { { "title", "benchmark" } };
+
+	const std::string path = (std::filesystem::temp_directory_path() / "ofs_benchmark.funscript").u8string();
+
+	float ms;
+	// how it used to be done: a json object per action which gets dumped into one big string
+	ms = OFS_BenchmarkRunner::Measure(1, [&](int32_t) {
+		nlohmann::json json = base;
+		auto& actionsJson = json["actions"];
+		for (auto action : actions) {
+			nlohmann::json actionObj = {
+				{ "at", action.at },
+				{ "pos", Util::Clamp<int32_t>(action.pos, 0, 100) }
+			};
+			actionsJson.emplace_back(std::move(actionObj));
+		}
+		Util::WriteJson(json, path.c_str());
+	});
+	OFS_BenchmarkRunner::Report("json + WriteJson", ms, ActionCount);
+
+	ms = OFS_BenchmarkRunner::Measure(1, [&](int32_t) {
+		OFS::io::WriteFunscript(path, actions, base);
+	});
+	OFS_BenchmarkRunner::Report("WriteFunscript", ms, ActionCount);
+
+	std::vector<FunscriptAction> loaded;
+	nlohmann::json rest;
+	if (!OFS::io::LoadFunscript(path, loaded, rest) || loaded.size() != actions.size() || rest != base) {
+		LOG_ERROR("WriteFunscript output doesn't round trip!");
+	}
+	std::error_code ec;
+	std::filesystem::remove(path, ec);
+}
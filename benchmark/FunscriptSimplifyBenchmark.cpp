@@ -0,0 +1,96 @@
+#include "OFS_BenchmarkRunner.h"
+
+#include "FunscriptSimplify.h"
+
+#include <cmath>
+
+// the simplification used to run from scratch on every epsilon change
+// this is a copy of that implementation for comparison
+static float PerpendicularDistance(FunscriptAction pt, FunscriptAction lineStart, FunscriptAction lineEnd) noexcept
+{
+	float dx = lineEnd.at - lineStart.at;
+	float dy = lineEnd.pos - lineStart.pos;
+	float mag = (float)std::sqrt(dx * dx + dy * dy);
+	if (mag > 0.0f) {
+		dx /= mag;
+		dy /= mag;
+	}
+	float pvx = pt.at - lineStart.at;
+	float pvy = pt.pos - lineStart.pos;
+	float pvdot = dx * pvx + dy * pvy;
+	float ax = pvx - pvdot * dx;
+	float ay = pvy - pvdot * dy;
+	return (float)std::sqrt(ax * ax + ay * ay);
+}
+
+static void RamerDouglasPeuckerIterative(const std::vector<FunscriptAction>& points, float epsilon, std::vector<FunscriptAction>& output) noexcept
+{
+	size_t start = 0;
+	size_t end = points.size() - 1;
+	while (start < end) {
+		output.push_back(points[start]);
+		size_t newEnd = end;
+		while (true) {
+			size_t maxDistanceIndex = 0;
+			float maxDistance = 0.0f;
+			for (size_t i = start + 1; i < newEnd; i++) {
+				float d = PerpendicularDistance(points[i], points[start], points[newEnd]);
+				if (d > maxDistance) {
+					maxDistanceIndex = i;
+					maxDistance = d;
+				}
+			}
+			if (maxDistance <= epsilon)
+				break;
+			newEnd = maxDistanceIndex;
+		}
+		start = newEnd;
+	}
+	output.push_back(points[end]);
+}
+
+// simulates dragging epsilon over a 5k action selection
+// the iterative version is way worse than O(n^2) for small epsilons which is why it only runs once
+OFS_REGISTER_BENCHMARK(FunscriptSimplify)
+{
+	constexpr int32_t SelectionSize = 5000;
+	constexpr int32_t IterativeSteps = 1;
+	constexpr int32_t DragSteps = 100;
+
+	auto random = OFS_BenchmarkRunner::GenerateActions(SelectionSize, 1);
+	// full strokes hit the same peaks over and over which is the worst case for a plain scan
+	auto strokes = OFS_BenchmarkRunner::GenerateActions(SelectionSize, 2);
+	for (int32_t i = 0; i < SelectionSize; i++) strokes[i].pos = i % 2 == 0 ? 0 : 100;
+
+	for (auto [name, points] : { std::make_pair("random", &random), std::make_pair("strokes", &strokes) }) {
+		char label[64];
+		float ms;
+
+		ms = OFS_BenchmarkRunner::Measure(1, [&](int32_t) {
+			for (int32_t step = 0; step < IterativeSteps; step++) {
+				std::vector<FunscriptAction> output;
+				RamerDouglasPeuckerIterative(*points, step * 0.5f, output);
+				OFS_BenchmarkRunner::Sink += output.size();
+			}
+		});
+		stbsp_snprintf(label, sizeof(label), "%s: iterative per step", name);
+		OFS_BenchmarkRunner::Report(label, ms, IterativeSteps);
+
+		std::vector<float> importance;
+		ms = OFS_BenchmarkRunner::Measure(1, [&](int32_t) {
+			OFS::simplify::RamerDouglasPeuckerImportance(*points, importance);
+		});
+		stbsp_snprintf(label, sizeof(label), "%s: importance", name);
+		OFS_BenchmarkRunner::Report(label, ms, 1);
+
+		ms = OFS_BenchmarkRunner::Measure(1, [&](int32_t) {
+			for (int32_t step = 0; step < DragSteps; step++) {
+				std::vector<FunscriptAction> output;
+				OFS::simplify::FilterByImportance(*points, importance, step * 0.5f, output);
+				OFS_BenchmarkRunner::Sink += output.size();
+			}
+		});
+		stbsp_snprintf(label, sizeof(label), "%s: threshold filter per step", name);
+		OFS_BenchmarkRunner::Report(label, ms, DragSteps);
+	}
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "OFS_Util.h"
+#include "OFS_Profiling.h"
+#include "FunscriptAction.h"
+
+#include <vector>
+#include <chrono>
+#include <random>
+#include <cstdint>
+
+class OFS_BenchmarkRunner
+{
+public:
+	struct Entry {
+		const char* Name;
+		void(*Run)();
+	};
+
+	struct Register {
+		inline Register(const char* name, void(*run)()) noexcept {
+			Registry().push_back({ name, run });
+		}
+	};
+
+	static std::vector<Entry>& Registry() noexcept {
+		static std::vector<Entry> registry;
+		return registry;
+	}
+
+	// keeps the compiler from throwing away results
+	static inline volatile int64_t Sink = 0;
+
+	// returns milliseconds for all iterations
+	template<typename Fn>
+	static float Measure(int32_t iterations, Fn&& fn) noexcept {
+		auto start = std::chrono::high_resolution_clock::now();
+		for (int32_t i = 0; i < iterations; i++) { fn(i); }
+		std::chrono::duration<float, std::milli> delta = std::chrono::high_resolution_clock::now() - start;
+		return delta.count();
+	}
+
+	static inline void Report(const char* name, float ms, int64_t operations) noexcept {
+		double perOp = operations > 0 ? (ms * 1000000.0) / operations : 0.0;
+		LOGF_INFO("%-40s %10.3f ms %12.1f ns/op (%lld ops)", name, ms, perOp, (long long)operations);
+	}
+
+	// sorted synthetic script with unique timestamps
+	static std::vector<FunscriptAction> GenerateActions(int32_t count, uint32_t seed = 1337) noexcept {
+		std::vector<FunscriptAction> actions;
+		actions.reserve(count);
+		std::mt19937 rng(seed);
+		std::uniform_int_distribution<int32_t> gap(10, 400);
+		std::uniform_int_distribution<int32_t> pos(0, 100);
+		int32_t at = 0;
+		for (int32_t i = 0; i < count; i++) {
+			at += gap(rng);
+			actions.emplace_back(at, pos(rng));
+		}
+		return actions;
+	}
+};
+
+#define OFS_REGISTER_BENCHMARK(name) \
+	static void name() noexcept; \
+	static OFS_BenchmarkRunner::Register OFS_CONCAT(xRegisterx_, name)(#name, name); \
+	static void name() noexcept
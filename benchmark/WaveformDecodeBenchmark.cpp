@@ -0,0 +1,70 @@
+#include "OFS_BenchmarkRunner.h"
+
+#include "OFS_Waveform.h"
+#include "SDL_cpuinfo.h"
+
+#include <random>
+
+// an hour of mono 128kbps mpeg1 layer 3 frames
+// the frames are silent since there's no encoder around to generate real audio
+// they still go through the whole synthesis, only the huffman decoding is skipped
+static std::vector<uint8_t> GenerateSilentMP3(int32_t seconds) noexcept
+{
+	constexpr int32_t FrameBytes = 144 * 128000 / 44100;
+	constexpr uint8_t Header[4] = { 0xFF, 0xFB, 0x90, 0xC0 };
+	const int32_t frameCount = seconds * 44100 / 1152;
+
+	std::vector<uint8_t> mp3(frameCount * FrameBytes, 0);
+	for (int32_t i = 0; i < frameCount; i++) {
+		std::copy(std::begin(Header), std::end(Header), mp3.begin() + i * FrameBytes);
+	}
+	return mp3;
+}
+
+// stereo frames with random side info & main data
+// the decoder turns that into loud noise on both channels which exercises the downmix
+static std::vector<uint8_t> GenerateNoisyStereoMP3(int32_t seconds) noexcept
+{
+	constexpr int32_t FrameBytes = 144 * 128000 / 44100;
+	constexpr uint8_t Header[4] = { 0xFF, 0xFB, 0x90, 0x00 };
+	const int32_t frameCount = seconds * 44100 / 1152;
+
+	std::mt19937 rng(1337);
+	std::vector<uint8_t> mp3(frameCount * FrameBytes);
+	for (auto& byte : mp3) byte = rng();
+	for (int32_t i = 0; i < frameCount; i++) {
+		std::copy(std::begin(Header), std::end(Header), mp3.begin() + i * FrameBytes);
+	}
+	return mp3;
+}
+
+static void compareDecodes(const char* name, const std::vector<uint8_t>& mp3, int32_t seconds) noexcept
+{
+	LOGF_INFO("%-40s %.2f MB", name, mp3.size() / (1024.f * 1024.f));
+	char label[64];
+	OFS_Waveform single;
+	float ms = OFS_BenchmarkRunner::Measure(1, [&](int32_t) {
+		single.DecodeMP3(mp3.data(), mp3.size(), 1);
+	});
+	stbsp_snprintf(label, sizeof(label), "%s single threaded", name);
+	OFS_BenchmarkRunner::Report(label, ms, seconds);
+
+	const int32_t threadCount = std::max(SDL_GetCPUCount(), 1);
+	OFS_Waveform parallel;
+	ms = OFS_BenchmarkRunner::Measure(1, [&](int32_t) {
+		parallel.DecodeMP3(mp3.data(), mp3.size(), threadCount);
+	});
+	stbsp_snprintf(label, sizeof(label), "%s %d threads", name, threadCount);
+	OFS_BenchmarkRunner::Report(label, ms, seconds);
+
+	if (single.SamplesFull != parallel.SamplesFull || single.SamplesHigh != parallel.SamplesHigh
+		|| single.SamplesMid != parallel.SamplesMid || single.SamplesLow != parallel.SamplesLow) {
+		LOGF_ERROR("%s: the parallel decode doesn't match the single threaded one!", name);
+	}
+}
+
+OFS_REGISTER_BENCHMARK(WaveformDecode)
+{
+	compareDecodes("silent mono", GenerateSilentMP3(60 * 60), 60 * 60);
+	compareDecodes("noisy stereo", GenerateNoisyStereoMP3(10 * 60), 10 * 60);
+}
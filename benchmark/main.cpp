@@ -0,0 +1,21 @@
+#include "OFS_BenchmarkRunner.h"
+
+#include "SDL.h"
+
+#include <cstring>
+
+// usage: OFS_benchmark [filter]
+// runs every registered benchmark which contains the filter in its name
+int main(int argc, char* argv[])
+{
+	const char* filter = argc > 1 ? argv[1] : nullptr;
+	int count = 0;
+	for (auto& benchmark : OFS_BenchmarkRunner::Registry()) {
+		if (filter != nullptr && std::strstr(benchmark.Name, filter) == nullptr) continue;
+		LOGF_INFO("==== %s ====", benchmark.Name);
+		benchmark.Run();
+		count++;
+	}
+	LOGF_INFO("Ran %d benchmark(s).", count);
+	return 0;
+}
@@ -5,6 +5,9 @@
 -- This file contains a really basic api to modify funscripts.
 
 Action = {at = 0, pos = 0, selected = false, tag = 0}
+-- action tables created by OFS use this metatable directly
+Action.__index = Action
+Action.__tostring = function(self) return string.format("at:%d pos:%d", self.at, self.pos) end
 
 -- internal use only
 function Action:new(o)
@@ -142,6 +145,10 @@ function Funscript:GetClosestActionBefore(time_ms)
 end
 
 -- context variables
+-- the actions of CurrentScript, LoadedScripts & Clipboard aren't lua tables but views into OFS
+-- they work with #, ipairs, pairs, table.insert, table.remove & table.sort like a table would
+-- an action taken from them refers to its position in the array, it's only valid till actions get inserted or removed
+-- globals defined by a script only live for a single run
 CurrentScript = Funscript:new() -- the currently active funscript.
 
 CurrentScriptIdx = 0 -- the index of the currently active funscript. only relevant when multiple scripts are loaded
@@ -162,6 +169,17 @@ VideoFileDirectory = "" -- the directory of the currently loaded video
 -- SetProgress(float) -- to set the progress for long processes with a value from 0.0 to 1.0
 -- SetSettings(table) -- call SetSettings with a lua table to export variables which can be edited in OFS. check out the examples for concrete usage
 
+-- native batch functions, these are a lot faster than looping over the actions in lua
+-- they only touch selected actions and replace the actions table of the script
+-- so action tables which were retrieved before calling them are stale afterwards
+-- Funscript:InterpolateSelection(stepMs, easing) -- adds points every stepMs between selected actions. easing is one of
+--    "linear", "easeInSine", "easeOutSine", "easeInOutSine", "easeInQuad", "easeOutQuad", "easeInOutQuad", "easeInCubic", "easeOutCubic", "easeInOutCubic"
+-- Funscript:OffsetSelection(timeMs, pos) -- moves the selection in time and/or position
+-- Funscript:ScaleSelection(factor, center) -- scales positions around center (default 50)
+-- Funscript:ClampSelection(minPos, maxPos) -- clamps positions
+-- Funscript:ResampleSelection(intervalMs) -- replaces the selection with points every intervalMs
+-- Funscript:JitterSelection(timeMs, pos, seed) -- random offsets in the range [-timeMs, timeMs] & [-pos, pos]. seed is optional
+
 -- utility functions which can be called
 -- round a number
 function round(x)
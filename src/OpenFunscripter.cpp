@@ -17,7 +17,6 @@
 
 // FIX: Add type checking to the deserialization. 
 //      I assume it would crash if a field is specified but doesn't have the correct type.
-// TODO: use a ringbuffer in the undosystem
 // TODO: improve shift click add action with simulator
 //       it bugs out if the simulator is on the same height as the script timeline
 
@@ -705,7 +704,7 @@ void OpenFunscripter::register_bindings()
             "Undo",
             false,
             [&](void*) { 
-                undoSystem->Undo(ActiveFunscript().get());
+                undoSystem->Undo();
             }
         );
         undo.key = Keybinding(
@@ -718,7 +717,7 @@ void OpenFunscripter::register_bindings()
             "Redo",
             false,
             [&](void*) { 
-                undoSystem->Redo(ActiveFunscript().get()); 
+                undoSystem->Redo(); 
             }
         ); 
         redo.key = Keybinding(
@@ -1461,7 +1460,6 @@ void OpenFunscripter::MpvVideoLoaded(SDL_Event& ev) noexcept
     ActiveFunscript()->metadata.title = name;
     auto recentFile = OpenFunscripterSettings::RecentFile{ name, std::string(player->getVideoPath()), ActiveFunscript()->current_path };
     settings->addRecentFile(recentFile);
-    scriptPositions.ClearAudioWaveform();
 
     tcode.reset();
     {
@@ -1495,9 +1493,44 @@ void OpenFunscripter::update() noexcept {
         autoBackup();
     }
 
+    // the TCode thread only ever reads these snapshots
+    for (auto& script : LoadedFunscripts) {
+        script->PublishSnapshot();
+    }
     tcode.sync(player->getCurrentPositionMsInterp(), player->getSpeed());
 }
 
+void OpenFunscripter::updateHeatmap() noexcept
+{
+    struct HeatmapData {
+        std::shared_ptr<OFS::HeatmapBuilder> builder;
+        std::shared_ptr<const std::vector<FunscriptAction>> actions;
+        float totalDurationMs;
+        ImGradient gradient;
+    };
+
+    heatmapComputing = true;
+    // the builder keeps the snapshot until the next update, nothing gets copied here
+    ActiveFunscript()->PublishSnapshot();
+    auto data = new HeatmapData{ heatmap, ActiveFunscript()->ActionSnapshot(), player->getDuration() * 1000.f };
+    auto thread = [](void* user) -> int {
+        auto data = (HeatmapData*)user;
+        data->builder->Update(std::move(data->actions));
+        data->builder->BuildGradient(data->totalDurationMs, data->gradient);
+        EventSystem::SingleShot([](void* ctx) {
+            // this code executes on the main thread during event processing
+            auto data = (HeatmapData*)ctx;
+            auto app = OpenFunscripter::ptr;
+            app->playerControls.TimelineGradient = data->gradient;
+            app->heatmapComputing = false;
+            delete data;
+        }, data);
+        return 0;
+    };
+    auto handle = SDL_CreateThread(thread, "Heatmap", data);
+    SDL_DetachThread(handle);
+}
+
 void OpenFunscripter::autoBackup() noexcept
 {
     if (ActiveFunscript()->current_path.empty()) { return; }
@@ -1588,9 +1621,11 @@ void OpenFunscripter::step() noexcept {
 
             playerControls.DrawControls(NULL);
 
-            if (updateTimelineGradient) {
+            // changes made while the heatmap is computing keep the flag set
+            // and get picked up by the next update
+            if (updateTimelineGradient && !heatmapComputing) {
                 updateTimelineGradient = false;
-                OFS::UpdateHeatmapGradient(player->getDuration() * 1000.f, playerControls.TimelineGradient, ActiveFunscript()->Actions());
+                updateHeatmap();
             }
 
             auto drawBookmarks = [&](ImDrawList* draw_list, const ImRect& frame_bb, bool item_hovered)
@@ -1813,6 +1848,12 @@ bool OpenFunscripter::openFile(const std::string& file)
         player->openVideo(video_path);
     }
 
+    // scripts which are still loading in the background belong to the previous file
+    scriptLoadGeneration++;
+    scriptLoadJob.reset();
+
+    // the root script gets loaded right away, the seek position, metadata & saving depend on it
+    // only the associated scripts get parsed in the background while the video loads
     auto openFunscript = [this](const std::string& file) -> bool {
         RootFunscript() = std::make_unique<Funscript>();
         if (!Util::FileExists(file)) {
@@ -1821,23 +1862,13 @@ bool OpenFunscripter::openFile(const std::string& file)
         return RootFunscript()->open<OFS_ScriptSettings>(file, "OpenFunscripter");
     };
 
-    // try load funscript
     bool result = openFunscript(funscript_path);
     if (!result) {
         LOGF_WARN("Couldn't find funscript. \"%s\"", funscript_path.c_str());
         // do not return false here future me
     }
-
-    if (result) {
-        auto& scriptSettings = RootFunscript()->Userdata<OFS_ScriptSettings>();
-        for (auto& associated : scriptSettings.associatedScripts) {
-            if (Util::FileExists(associated)) {
-                auto associated_script = std::make_unique<Funscript>();
-                if (associated_script->open<OFS_ScriptSettings>(associated, "OpenFunscripter")) {
-                    LoadedFunscripts.emplace_back(std::move(associated_script));
-                }
-            }
-        }
+    else {
+        loadAssociatedScriptsAsync();
     }
 
     RootFunscript()->current_path = funscript_path;
@@ -1855,6 +1886,38 @@ bool OpenFunscripter::openFile(const std::string& file)
     return result;
 }
 
+void OpenFunscripter::loadAssociatedScriptsAsync() noexcept
+{
+    // the root script knows which scripts belong to it
+    std::vector<std::string> associatedPaths;
+    for (auto& associated : RootFunscript()->Userdata<OFS_ScriptSettings>().associatedScripts) {
+        if (Util::FileExists(associated)) {
+            associatedPaths.emplace_back(associated);
+        }
+    }
+    if (associatedPaths.empty()) return;
+
+    uint32_t generation = scriptLoadGeneration;
+    scriptLoadJob = FunscriptLoader::Load(associatedPaths, [this, generation](auto& results) {
+        if (generation != scriptLoadGeneration) return;
+        for (auto& result : results) {
+            if (!result.success) continue;
+            auto associatedScript = std::make_shared<Funscript>();
+            associatedScript->open<OFS_ScriptSettings>(result.path, "OpenFunscripter", std::move(result.actions), std::move(result.json));
+            LoadedFunscripts.emplace_back(std::move(associatedScript));
+        }
+        scriptLoadJob.reset();
+        UpdateNewActiveScript(ActiveFunscriptIdx);
+
+        // the video may have been loaded first, playing hands the scripts over again anyway
+        if (player->isLoaded() && player->isPaused()) {
+            std::vector<std::weak_ptr<const Funscript>> scripts;
+            scripts.assign(LoadedFunscripts.begin(), LoadedFunscripts.end());
+            tcode.setScripts(std::move(scripts));
+        }
+    });
+}
+
 void OpenFunscripter::UpdateNewActiveScript(int32_t activeIndex) noexcept
 {
     ActiveFunscriptIdx = activeIndex;
@@ -2027,7 +2090,18 @@ void OpenFunscripter::copySelection() noexcept
         for (auto action : ActiveFunscript()->Selection()) {
             CopiedSelection.emplace_back(action);
         }
+        clipboardSnapshot.reset();
+    }
+}
+
+std::shared_ptr<const std::vector<FunscriptAction>> OpenFunscripter::FunscriptClipboardSnapshot() noexcept
+{
+    if (!clipboardSnapshot) {
+        auto clipboard = std::make_shared<std::vector<FunscriptAction>>(CopiedSelection);
+        for (auto& action : *clipboard) action.SetSelected(false);
+        clipboardSnapshot = std::move(clipboard);
     }
+    return clipboardSnapshot;
 }
 
 void OpenFunscripter::pasteSelection() noexcept
@@ -2045,9 +2119,11 @@ void OpenFunscripter::pasteSelection() noexcept
         ActiveFunscript()->RemoveActionsInInterval(currentMs, currentMs + (CopiedSelection.back().at - CopiedSelection.front().at));
     }
 
+    ActiveFunscript()->BeginBatchEdit();
     for (auto&& action : CopiedSelection) {
         ActiveFunscript()->PasteAction(FunscriptAction(action.at + offset_ms, action.pos), 1);
     }
+    ActiveFunscript()->CommitBatchEdit();
     player->setPositionExact((CopiedSelection.end() - 1)->at + offset_ms);
 }
 
@@ -2062,9 +2138,11 @@ void OpenFunscripter::pasteSelectionExact() noexcept {
 
     // paste without altering timestamps
     undoSystem->Snapshot(StateType::PASTE_COPIED_ACTIONS, false, ActiveFunscript().get());
+    ActiveFunscript()->BeginBatchEdit();
     for (auto&& action : CopiedSelection) {
         ActiveFunscript()->PasteAction(action, 1);
     }
+    ActiveFunscript()->CommitBatchEdit();
 }
 
 void OpenFunscripter::equalizeSelection() noexcept
@@ -2136,6 +2214,7 @@ void OpenFunscripter::repeatLastStroke() noexcept
         int32_t offset_ms = player->getCurrentPositionMsInterp() - stroke.back().at;
         undoSystem->Snapshot(StateType::REPEAT_STROKE, false, ActiveFunscript().get());
         auto action = ActiveFunscript()->GetActionAtTime(player->getCurrentPositionMsInterp(), player->getFrameTimeMs());
+        ActiveFunscript()->BeginBatchEdit();
         // if we are on top of an action we ignore the first action of the last stroke
         if (action != nullptr) {
             for(int i=stroke.size()-2; i >= 0; i--) {
@@ -2151,6 +2230,7 @@ void OpenFunscripter::repeatLastStroke() noexcept
                 ActiveFunscript()->PasteAction(action, player->getFrameTimeMs());
             }
         }
+        ActiveFunscript()->CommitBatchEdit();
         player->setPositionExact(stroke.front().at + offset_ms);
     }
 }
@@ -2390,10 +2470,10 @@ void OpenFunscripter::ShowMainMenuBar() noexcept
             }
             ImGui::Separator();
             if (ImGui::MenuItem("Undo", BINDING_STRING("undo"), false, !undoSystem->UndoEmpty())) {
-                undoSystem->Undo(ActiveFunscript().get());
+                undoSystem->Undo();
             }
             if (ImGui::MenuItem("Redo", BINDING_STRING("redo"), false, !undoSystem->RedoEmpty())) {
-                undoSystem->Redo(ActiveFunscript().get());
+                undoSystem->Redo();
             }
             ImGui::Separator();
             if (ImGui::MenuItem("Cut", BINDING_STRING("cut"), false, ActiveFunscript()->HasSelection())) {
@@ -2620,6 +2700,9 @@ void OpenFunscripter::ShowMainMenuBar() noexcept
             bool navmodeActive = ImGui::GetIO().ConfigFlags & ImGuiConfigFlags_NavEnableGamepad;
             ImGui::Text(ICON_GAMEPAD " " ICON_LONG_ARROW_RIGHT " %s", (navmodeActive) ? "Navigation" : "Scripting");
         }
+        if (scriptLoadJob) {
+            ImGui::ProgressBar(scriptLoadJob->Done() / (float)scriptLoadJob->Total(), ImVec2(ImGui::GetFontSize() * 8.f, 0.f), "Loading scripts...");
+        }
         if (player->isLoaded() && ActiveFunscript()->HasUnsavedEdits()) {
             const float timeUnit = saveDuration.count() / 60.f;
             ImGui::SameLine(region.x - ImGui::GetFontSize()*13.5f);
@@ -28,6 +28,8 @@
 #include "OFS_Events.h"
 #include "OFS_VideoplayerControls.h"
 #include "OFS_TCode.h"
+#include "FunscriptLoader.h"
+#include "FunscriptHeatmap.h"
 
 #include <memory>
 #include <array>
@@ -47,10 +49,15 @@ private:
 	bool ShowAbout = false;
 	
 	std::vector<FunscriptAction> CopiedSelection;
+	// handed to lua runs, rebuilt lazily after the next copy
+	std::shared_ptr<const std::vector<FunscriptAction>> clipboardSnapshot;
 
 	std::chrono::system_clock::time_point last_backup;
 
 	bool updateTimelineGradient = false;
+	// the heatmap is computed on a worker thread, one update at a time
+	bool heatmapComputing = false;
+	std::shared_ptr<OFS::HeatmapBuilder> heatmap = std::make_shared<OFS::HeatmapBuilder>();
 	char tmp_buf[2][32];
 
 	int32_t ActiveFunscriptIdx = 0;
@@ -61,6 +68,7 @@ private:
 	void new_frame() noexcept;
 	void render() noexcept;
 	void autoBackup() noexcept;
+	void updateHeatmap() noexcept;
 
 	bool load_fonts(const char* font_override = nullptr) noexcept;
 	bool imgui_setup() noexcept;
@@ -109,6 +117,11 @@ private:
 	void showOpenFileDialog();
 	void saveActiveScriptAs();
 	bool openFile(const std::string& file);
+
+	// only set while scripts are getting parsed in the background
+	std::shared_ptr<FunscriptLoader::Job> scriptLoadJob;
+	uint32_t scriptLoadGeneration = 0;
+	void loadAssociatedScriptsAsync() noexcept;
 	
 	void SetFullscreen(bool fullscreen);
 
@@ -173,6 +186,7 @@ public:
 	static void SetCursorType(ImGuiMouseCursor id) noexcept;
 
 	inline const std::vector<FunscriptAction>& FunscriptClipboard() const { return CopiedSelection; }
+	std::shared_ptr<const std::vector<FunscriptAction>> FunscriptClipboardSnapshot() noexcept;
 
 	inline bool LoadOverrideFont(const std::string& font) noexcept { return load_fonts(font.empty() ? nullptr : font.c_str()); }
 };
@@ -273,6 +273,7 @@ inline void RecordingImpl::finishSingleAxisRecording() noexcept
     if (app->settings->data().mirror_mode) {
         app->undoSystem->Snapshot(StateType::GENERATE_ACTIONS, true, app->ActiveFunscript().get());
         for (auto&& script : app->LoadedFunscripts) {
+            script->BeginBatchEdit();
             for (auto&& actionP : app->scriptPositions.RecordingBuffer) {
                 auto& action = actionP.first;
                 if (action.at >= 0) {
@@ -280,10 +281,12 @@ inline void RecordingImpl::finishSingleAxisRecording() noexcept
                     script->AddActionSafe(action);
                 }
             }
+            script->CommitBatchEdit();
         }
     }
     else {
         app->undoSystem->Snapshot(StateType::GENERATE_ACTIONS, false, app->ActiveFunscript().get());
+        ctx().BeginBatchEdit();
         for (auto&& actionP : app->scriptPositions.RecordingBuffer) {
             auto& action = actionP.first;
             if (action.at >= 0) {
@@ -291,6 +294,7 @@ inline void RecordingImpl::finishSingleAxisRecording() noexcept
                 ctx().AddActionSafe(action);
             }
         }
+        ctx().CommitBatchEdit();
     }
     app->scriptPositions.RecordingBuffer.clear();
 }
@@ -304,6 +308,7 @@ inline void RecordingImpl::finishTwoAxisRecording() noexcept
     int32_t pitchIdx = app->sim3D->pitchIndex;
     if (rollIdx > 0 && rollIdx < app->LoadedFunscripts.size()) {
         auto& script = app->LoadedFunscripts[rollIdx];
+        script->BeginBatchEdit();
         for (auto&& actionP : app->scriptPositions.RecordingBuffer) {
             auto& actionX = actionP.first;
             if (actionX.at >= 0) {
@@ -311,9 +316,11 @@ inline void RecordingImpl::finishTwoAxisRecording() noexcept
                 script->AddActionSafe(actionX);
             }
         }
+        script->CommitBatchEdit();
     }
     if (pitchIdx > 0 && pitchIdx < app->LoadedFunscripts.size()) {
         auto& script = app->LoadedFunscripts[pitchIdx];
+        script->BeginBatchEdit();
         for (auto&& actionP : app->scriptPositions.RecordingBuffer) {
             auto& actionY = actionP.second;
             if (actionY.at >= 0) {
@@ -321,6 +328,7 @@ inline void RecordingImpl::finishTwoAxisRecording() noexcept
                 script->AddActionSafe(actionY);
             }
         }
+        script->CommitBatchEdit();
     }
     app->scriptPositions.RecordingBuffer.clear();
 }
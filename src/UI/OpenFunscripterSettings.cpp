@@ -117,6 +117,17 @@ bool OpenFunscripterSettings::ShowPreferenceWindow()
 		}
 		Util::Tooltip("Amount of frames to skip with fast step.");
 
+		if (ImGui::InputInt("Undo memory budget (MB)", &UndoSystem::MemoryBudgetMB, 16, 128)) {
+			save = true;
+			UndoSystem::MemoryBudgetMB = Util::Clamp<int32_t>(UndoSystem::MemoryBudgetMB, 16, 8192);
+		}
+		Util::Tooltip("Shared by all loaded scripts. The oldest undo steps get dropped when exceeded.");
+
+		if (ImGui::Checkbox("Cache funscripts", &OFS::io::FunscriptCacheEnabled)) {
+			save = true;
+		}
+		Util::Tooltip("Keeps a binary copy of opened scripts which makes reopening big projects a lot faster.\nThe .funscript stays the source of truth.");
+
 		ImGui::EndPopup();
 	}
 
@@ -13,6 +13,7 @@
 #include "imgui.h"
 
 #include "OFS_ScriptPositionsOverlays.h"
+#include "OFS_UndoSystem.h"
 
 constexpr const char* CurrentSettingsVersion = "1";
 class OpenFunscripterSettings
@@ -106,6 +107,8 @@ private:
 			OFS_REFLECT(show_tcode, ar);
 			OFS_REFLECT_PTR(simulator, ar);
 			OFS_REFLECT_NAMED("SplineMode", BaseOverlay::SplineMode, ar);
+			OFS_REFLECT_NAMED("UndoMemoryBudgetMB", UndoSystem::MemoryBudgetMB, ar);
+			OFS_REFLECT_NAMED("FunscriptCache", OFS::io::FunscriptCacheEnabled, ar);
 		}
 	} scripterSettings;
 
@@ -1,15 +1,18 @@
 #include "SpecialFunctions.h"
 #include "OpenFunscripter.h"
 #include "FunscriptUndoSystem.h"
+#include "FunscriptSimplify.h"
 #include "imgui.h"
 #include "imgui_stdlib.h"
 #include "imgui_internal.h"
 
 #include "OFS_Lua.h"
+#include "OFS_LuaKernels.h"
+#include "OFS_LuaActionView.h"
 
 #include <filesystem>
 #include <sstream>
-#include <unordered_set>
+#include <algorithm>
 
 #include "SDL_thread.h"
 #include "SDL_atomic.h"
@@ -97,7 +100,7 @@ void FunctionRangeExtender::DrawUI() noexcept
                 app->undoSystem->Snapshot(StateType::RANGE_EXTEND, false, app->ActiveFunscript().get());
             }
             else {
-                app->undoSystem->Undo(app->ActiveFunscript().get());
+                app->undoSystem->Undo();
                 app->undoSystem->Snapshot(StateType::RANGE_EXTEND, false, app->ActiveFunscript().get());
             }
             createUndoState = false;
@@ -114,6 +117,9 @@ RamerDouglasPeucker::RamerDouglasPeucker() noexcept
 {
     auto app = OpenFunscripter::ptr;
     app->events->Subscribe(FunscriptEvents::FunscriptSelectionChangedEvent, EVENT_SYSTEM_BIND(this, &RamerDouglasPeucker::SelectionChanged));
+    if (ctx().SelectionSize() > 4) {
+        startComputation();
+    }
 }
 
 RamerDouglasPeucker::~RamerDouglasPeucker() noexcept
@@ -127,68 +133,62 @@ void RamerDouglasPeucker::SelectionChanged(SDL_Event& ev) noexcept
         epsilon = 0.f;
         createUndoState = true;
     }
-}
-
-static float PerpendicularDistance(FunscriptAction pt, FunscriptAction lineStart, FunscriptAction lineEnd)
-{
-    float dx = lineEnd.at - lineStart.at;
-    float dy = lineEnd.pos - lineStart.pos;
-
-    // Normalize
-    float mag = (float)std::sqrt(dx * dx + dy * dy);
-    if (mag > 0.0f)
-    {
-        dx /= mag;
-        dy /= mag;
+    // undoing a simplification restores a selection which is already known
+    if (ctx().SelectionSize() > 4 && (simplification->computing || simplification->points != ctx().Selection())) {
+        startComputation();
     }
-    float pvx = pt.at - lineStart.at;
-    float pvy = pt.pos - lineStart.pos;
-
-    // Get dot product (project pv onto normalized direction)
-    float pvdot = dx * pvx + dy * pvy;
-
-    // Scale line direction vector and subtract it from pv
-    float ax = pvx - pvdot * dx;
-    float ay = pvy - pvdot * dy;
-
-    return (float)std::sqrt(ax * ax + ay * ay);
 }
 
-static void RamerDouglasPeuckerIterative(std::vector<FunscriptAction>& points, float epsilon, std::vector<FunscriptAction>& output)
+void RamerDouglasPeucker::startComputation() noexcept
 {
-    size_t start = 0;
-    size_t end = points.size() - 1;
+    struct ComputeData {
+        std::shared_ptr<Simplification> target;
+        uint32_t generation;
+        std::vector<FunscriptAction> points;
+        std::vector<float> importance;
+    };
 
-    while (start < end)
-    {
-        output.push_back(points[start]);
-        size_t newEnd = end;
-        while (true)
-        {
-            size_t maxDistanceIndex = 0;
-            float maxDistance = 0.0f;
-            for (size_t i = start + 1; i < newEnd; i++)
-            {
-                float d = PerpendicularDistance(points[i], points[start], points[newEnd]);
-                if (d > maxDistance)
-                {
-                    maxDistanceIndex = i;
-                    maxDistance = d;
-                }
+    auto& state = *simplification;
+    state.generation++;
+    state.computing = true;
+    state.points.clear();
+    state.importance.clear();
+
+    auto data = new ComputeData{ simplification, state.generation, ctx().Selection() };
+    auto thread = [](void* user) -> int {
+        auto data = (ComputeData*)user;
+        OFS::simplify::RamerDouglasPeuckerImportance(data->points, data->importance);
+        EventSystem::SingleShot([](void* ctx) {
+            // this code executes on the main thread during event processing
+            auto data = (ComputeData*)ctx;
+            auto& state = *data->target;
+            // results for an outdated selection get dropped
+            if (state.generation == data->generation) {
+                state.points = std::move(data->points);
+                state.importance = std::move(data->importance);
+                state.computing = false;
             }
-            if (maxDistance <= epsilon)
-                break;
-            newEnd = maxDistanceIndex;
-        }
-        start = newEnd;
-    }
-    output.push_back(points[end]);
+            delete data;
+        }, data);
+        return 0;
+    };
+    auto handle = SDL_CreateThread(thread, "RamerDouglasPeucker", data);
+    SDL_DetachThread(handle);
 }
 
 void RamerDouglasPeucker::DrawUI() noexcept
 {
     auto app = OpenFunscripter::ptr;
-    if (app->script().SelectionSize() > 4 || (app->script().undoSystem->MatchUndoTop(StateType::SIMPLIFY))) {
+    auto& state = *simplification;
+    if (!state.computing && state.points.empty() && ctx().SelectionSize() > 4) {
+        // the selection came from a script which was switched to
+        startComputation();
+    }
+
+    if (state.computing) {
+        ImGui::TextUnformatted("Analyzing selection...");
+    }
+    else if (!state.points.empty() && (app->script().SelectionSize() > 4 || (app->script().undoSystem->MatchUndoTop(StateType::SIMPLIFY)))) {
         if (ImGui::DragFloat("Epsilon", &epsilon, 0.1f)) {
             epsilon = std::max(epsilon, 0.f);
             if (createUndoState ||
@@ -196,20 +196,26 @@ void RamerDouglasPeucker::DrawUI() noexcept
                 // NOOP
             }
             else {
-                app->undoSystem->Undo(app->ActiveFunscript().get());
+                app->undoSystem->Undo();
             }
             app->undoSystem->Snapshot(StateType::SIMPLIFY, false, app->ActiveFunscript().get());
 
             createUndoState = false;
-            auto selection = ctx().Selection();
-            ctx().RemoveSelectedActions();
-            std::vector<FunscriptAction> newActions;
-            newActions.reserve(selection.size());
-            RamerDouglasPeuckerIterative(selection, epsilon, newActions);
-            for (auto&& action : newActions) {
-                ctx().AddAction(action);
+            // the importance only applies to the selection it was computed for
+            // the active script might have changed without a selection event
+            if (ctx().Selection() == state.points) {
+                std::vector<FunscriptAction> newActions;
+                newActions.reserve(state.points.size());
+                OFS::simplify::FilterByImportance(state.points, state.importance, epsilon, newActions);
+                ctx().ReplaceSelection(newActions);
+            }
+            else if (ctx().SelectionSize() > 4) {
+                startComputation();
             }
         }
+        auto kept = std::count_if(state.importance.begin(), state.importance.end(),
+            [this](float importance) { return importance > epsilon; });
+        ImGui::Text("%d of %d points", (int)kept, (int)state.points.size());
     }
     else
     {
@@ -223,7 +229,6 @@ struct LuaThread {
     lua_State* L = nullptr;
     CustomLua::LuaScript* script = nullptr;
     
-    std::string setupScript;
     int result = 0;
     bool running = false;
     bool dry_run = false;
@@ -234,9 +239,28 @@ struct LuaThread {
     float progress = 0.f;
     int32_t NewPositionMs = -1;
 
+    // snapshots taken on the main thread which lua reads through OFS::lua::ActionArray
+    // the selection is part of the actions (FunscriptAction::Flags::Selected)
+    struct ScriptInput {
+        std::string title;
+        std::string path;
+        std::shared_ptr<const std::vector<FunscriptAction>> actions;
+    };
+    struct Inputs {
+        std::vector<ScriptInput> scripts;
+        std::shared_ptr<const std::vector<FunscriptAction>> clipboard;
+        int32_t scriptIndex = 0;
+        std::string videoPath;
+        std::string videoDirectory;
+        double frameTimeMs = 0.0;
+        float totalTimeMs = 0.f;
+    } inputs;
+
     struct ScriptOutput {
-        std::unordered_set<FunscriptAction, FunscriptActionHashfunction> actions;
-        std::unordered_set<FunscriptAction, FunscriptActionHashfunction> selection;
+        // false when the script never wrote to the actions
+        bool changed = true;
+        std::vector<FunscriptAction> actions;
+        std::vector<FunscriptAction> selection;
     };
     std::vector<ScriptOutput> outputs;
 };
@@ -353,12 +377,18 @@ static constexpr struct luaL_Reg printlib[] = {
   {NULL, NULL} /* end of array */
 };
 
-static int LuaDoFile(lua_State* L, const char* path) {
+// env is the stack index of a table which replaces _ENV of the chunk, 0 to run in _G
+static int LuaDoFile(lua_State* L, const char* path, int env = 0) {
     std::vector<uint8_t> file;
     if (Util::ReadFile(path, file) > 0) {
-        file.emplace_back('\0');
-        int result = luaL_dostring(L, (const char*)file.data());
-        return result;
+        std::string chunkName = std::string("@") + path; // errors show up as path:line
+        int result = luaL_loadbuffer(L, (const char*)file.data(), file.size(), chunkName.c_str());
+        if (result != LUA_OK) return result;
+        if (env != 0) {
+            lua_pushvalue(L, env);
+            lua_setupvalue(L, -2, 1); // the first upvalue of a chunk is _ENV
+        }
+        return lua_pcall(L, 0, LUA_MULTRET, 0);
     }
     return -1;
 }
@@ -417,38 +447,40 @@ void CustomLua::resetVM() noexcept
 
         auto LuaSetSettings = [](lua_State* L) -> int {
             if (!Thread.dry_run && Thread.script->settings.values.size() > 0) {
-                std::stringstream ss;
-                ss << Util::Format("%s = {}\n", Thread.script->settings.name.c_str());
+                // the values get written into the table passed by the script
+                // scripts run in their own environment so setting a global wouldn't reach them
+                if (!lua_istable(L, 1)) {
+                    lua_settop(L, 0);
+                    lua_createtable(L, 0, Thread.script->settings.values.size());
+                }
                 for (auto&& value : Thread.script->settings.values) {
                     switch (value.type) {
                     case LuaScript::Settings::Value::Type::Bool:
                     {
                         bool* b = (bool*)&Thread.script->settings.buffer[value.offset];
-                        ss << Util::Format("%s.%s = %s\n", Thread.script->settings.name.c_str(),
-                            value.name.c_str(),
-                            *b ? "true" : "false");
+                        lua_pushboolean(L, *b);
                         break;
                     }
                     case LuaScript::Settings::Value::Type::Float:
                     {
                         float* f = (float*)&Thread.script->settings.buffer[value.offset];
-                        ss << Util::Format("%s.%s = %f\n", Thread.script->settings.name.c_str(),
-                            value.name.c_str(),
-                            *f);
+                        lua_pushnumber(L, *f);
                         break;
                     }
                     case LuaScript::Settings::Value::Type::String:
                     {
                         std::string* s = (std::string*)&Thread.script->settings.buffer[value.offset];
-                        ss << Util::Format("%s.%s = \"%s\"\n", Thread.script->settings.name.c_str(),
-                            value.name.c_str(),
-                            s->c_str());
+                        lua_pushstring(L, s->c_str());
                         break;
                     }
+                    default:
+                        lua_pushnil(L);
+                        break;
                     }
+                    lua_setfield(L, 1, value.name.c_str());
                 }
-                ss << Util::Format("return %s\n", Thread.script->settings.name.c_str());
-                luaL_dostring(L, ss.str().c_str());
+                lua_settop(L, 1);
+                return 1;
             }
             // only a dry_run will update settings
             else if (lua_istable(L, 1)) {
@@ -562,129 +594,154 @@ void CustomLua::resetVM() noexcept
             WriteToConsole(tmp);
             LOG_ERROR(tmp);
         }
+        OFS::lua::RegisterActionView(Thread.L);
+        OFS::lua::RegisterKernels(Thread.L);
+    }
+}
 
-        auto app = OpenFunscripter::ptr;
-        auto& script = app->ActiveFunscript();
-        const int32_t scriptIndex = app->ActiveFunscriptIndex();
-        auto& actions = script->Actions();
+void CustomLua::prepareInputs() noexcept
+{
+    auto app = OpenFunscripter::ptr;
+    auto& inputs = Thread.inputs;
+
+    inputs.scriptIndex = app->ActiveFunscriptIndex();
+    inputs.scripts.resize(app->LoadedFunscripts.size());
+    Thread.TotalActionCount = 0;
+    for (int i = 0; i < app->LoadedFunscripts.size(); i++) {
+        auto& loadedScript = app->LoadedFunscripts[i];
+        auto& input = inputs.scripts[i];
+        input.title = loadedScript->metadata.title;
+        input.path = loadedScript->current_path;
+        // shares the snapshot the TCode thread reads, only copies if the script changed this frame
+        loadedScript->PublishSnapshot();
+        input.actions = loadedScript->ActionSnapshot();
+        Thread.TotalActionCount += input.actions->size();
+    }
 
-        int32_t index = 0;
-        int32_t totalWork = actions.size() + app->FunscriptClipboard().size();
+    inputs.clipboard = app->FunscriptClipboardSnapshot();
+    Thread.ClipboardCount = inputs.clipboard->size();
 
-        Thread.TotalActionCount = 0;
-        for (auto&& script : app->LoadedFunscripts) {
-            Thread.TotalActionCount += script->Actions().size();
-        }
-        
-        Thread.ClipboardCount = app->FunscriptClipboard().size();
-
-        std::stringstream builder;
-
-        // clipboard
-        for (auto&& action : app->FunscriptClipboard()) {
-            stbsp_snprintf(tmp, sizeof(tmp), "Clipboard:AddActionUnordered(%d, %d, false, %d)\n",
-                action.at,
-                action.pos,
-                action.tag
-            );
-            builder << tmp;
-
-            index++;
-            // update progressbar
-            index++;
-            if (index % 100 == 0 && totalWork > 0) {
-                stbsp_snprintf(tmp, sizeof(tmp), "SetProgress(%f)\n", (float)index / totalWork);
-                builder << tmp;
-            }
-        }
-
-        stbsp_snprintf(tmp, sizeof(tmp), "CurrentScriptIdx=%d\n", scriptIndex+1); // !!! lua indexing starts at 1 !!!
-        builder << tmp;
-
-        std::unordered_set<FunscriptAction, FunscriptActionHashfunction> SelectedActions;
-        for (int i = 0; i < app->LoadedFunscripts.size(); i++) {
-            auto& loadedScript = app->LoadedFunscripts[i];
-            SelectedActions.clear(); SelectedActions.insert(loadedScript->Selection().begin(), loadedScript->Selection().end());
-
-            builder << "table.insert(LoadedScripts,Funscript:new())\n";
-
-            // i+1 because lua indexing starts at 1 !!!
-            stbsp_snprintf(tmp, sizeof(tmp), "LoadedScripts[%d].title=[[%s]]\n", i+1, loadedScript->metadata.title.c_str());
-            builder << tmp;
-            stbsp_snprintf(tmp, sizeof(tmp), "LoadedScripts[%d].path=[[%s]]\n", i+1, loadedScript->current_path.c_str());
-            builder << tmp;
-
-            for (auto&& action : loadedScript->Actions()) {
-                stbsp_snprintf(tmp, sizeof(tmp), "LoadedScripts[%d]:AddActionUnordered(%d,%d,%s,%d)\n",
-                    i + 1, // !!! lua indexing starts at 1 !!!
-                    action.at,
-                    action.pos,
-                    SelectedActions.find(action) != SelectedActions.end() ? "true" : "false",
-                    action.tag
-                );
-                builder << tmp;
-            }
+    auto vPath = app->player->getVideoPath();
+    inputs.videoPath = vPath ? vPath : "";
+    inputs.videoDirectory.clear();
+    if (vPath) {
+        auto path = Util::PathFromString(vPath);
+        path.replace_filename("");
+        inputs.videoDirectory = path.u8string();
+    }
 
-            if (i == scriptIndex) { 
-                stbsp_snprintf(tmp, sizeof(tmp), "CurrentScript=LoadedScripts[%d]\n", i + 1, loadedScript->current_path.c_str());
-                builder << tmp;
-                continue; 
-            }
-        }
+    Thread.NewPositionMs = app->player->getCurrentPositionMsInterp();
+    inputs.frameTimeMs = app->player->getFrameTimeMs();
+    inputs.totalTimeMs = static_cast<float>(app->player->getDuration() * 1000.f);
+}
 
-        {
-            // paths
-            stbsp_snprintf(tmp, sizeof(tmp), "VideoFilePath=[[%s]]\n", app->player->getVideoPath());
-            builder << tmp;
-
-            auto vPath = app->player->getVideoPath();
-            if (vPath) {
-                auto path = Util::PathFromString(vPath);
-                path.replace_filename("");
-                stbsp_snprintf(tmp, sizeof(tmp), "VideoFileDirectory=[[%s]]\n", path.u8string().c_str());
-                builder << tmp;
-            }
-        }
+// pushes a new Funscript table onto the stack
+static void PushFunscript(lua_State* L) noexcept
+{
+    lua_getglobal(L, "Funscript");
+    lua_getfield(L, -1, "new");
+    lua_pushvalue(L, -2); // self
+    lua_call(L, 1, 1);
+    lua_remove(L, -2); // pop Funscript
+}
 
-        Thread.NewPositionMs = app->player->getCurrentPositionMsInterp();
-        stbsp_snprintf(tmp, sizeof(tmp), "CurrentTimeMs=%d\n", Thread.NewPositionMs);
-        builder << tmp;
-        stbsp_snprintf(tmp, sizeof(tmp), "FrameTimeMs=%lf\n", app->player->getFrameTimeMs());
-        builder << tmp;
-        stbsp_snprintf(tmp, sizeof(tmp), "TotalTimeMs=%f\n", static_cast<float>(app->player->getDuration() * 1000.f));
-        builder << tmp;
+// pushes a table which is used as the global environment of a single run
+// globals defined by the script end up in there and get dropped after the run
+// everything else is looked up in _G which persists
+static int PushRunEnvironment(lua_State* L) noexcept
+{
+    lua_createtable(L, 0, 16);
+    lua_createtable(L, 0, 1);
+    lua_pushglobaltable(L);
+    lua_setfield(L, -2, "__index");
+    lua_setmetatable(L, -2);
+    return lua_gettop(L);
+}
 
+// fills the globals declared in funscript.lua
+// these are set in _G so that required modules see them as well
+static bool SetupScriptInputs(LuaThread& thread, lua_State* L) noexcept
+{
+    auto& inputs = thread.inputs;
 
-        // reset progress for user script
-        stbsp_snprintf(tmp, sizeof(tmp), "SetProgress(%f)\n", 0.f);
-        builder << tmp;
+    lua_getglobal(L, "Funscript");
+    if (!lua_istable(L, -1)) {
+        lua_pop(L, 1);
+        return false;
+    }
+    lua_pop(L, 1);
+
+    PushFunscript(L);
+    OFS::lua::PushActionArray(L, inputs.clipboard);
+    lua_setfield(L, -2, "actions");
+    lua_setglobal(L, "Clipboard");
+
+    lua_pushinteger(L, inputs.scriptIndex + 1); // !!! lua indexing starts at 1 !!!
+    lua_setglobal(L, "CurrentScriptIdx");
+
+    lua_createtable(L, inputs.scripts.size(), 0); // LoadedScripts
+    for (int i = 0; i < inputs.scripts.size(); i++) {
+        auto& input = inputs.scripts[i];
+        PushFunscript(L);
+        lua_pushstring(L, input.title.c_str());
+        lua_setfield(L, -2, "title");
+        lua_pushstring(L, input.path.c_str());
+        lua_setfield(L, -2, "path");
+
+        OFS::lua::PushActionArray(L, input.actions);
+        lua_setfield(L, -2, "actions");
+
+        if (i == inputs.scriptIndex) {
+            lua_pushvalue(L, -1);
+            lua_setglobal(L, "CurrentScript");
+        }
+        lua_rawseti(L, -2, i + 1); // !!! lua indexing starts at 1 !!!
+    }
+    lua_setglobal(L, "LoadedScripts");
+
+    lua_pushstring(L, inputs.videoPath.c_str());
+    lua_setglobal(L, "VideoFilePath");
+    lua_pushstring(L, inputs.videoDirectory.c_str());
+    lua_setglobal(L, "VideoFileDirectory");
+
+    lua_pushinteger(L, thread.NewPositionMs);
+    lua_setglobal(L, "CurrentTimeMs");
+    lua_pushnumber(L, inputs.frameTimeMs);
+    lua_setglobal(L, "FrameTimeMs");
+    lua_pushnumber(L, inputs.totalTimeMs);
+    lua_setglobal(L, "TotalTimeMs");
+
+    // lua holds the snapshots now
+    inputs.scripts.clear();
+    inputs.clipboard.reset();
+    thread.progress = 0.f;
+    return true;
+}
 
-        Thread.setupScript = std::move(builder.str());
+// releases the snapshots held by the globals of the last run
+static void ClearScriptInputs(lua_State* L) noexcept
+{
+    for (auto name : { "Clipboard", "CurrentScript", "LoadedScripts" }) {
+        lua_pushnil(L);
+        lua_setglobal(L, name);
     }
 }
 
-bool CollectScriptOutputs(LuaThread& thread, lua_State* L) noexcept
+bool CollectScriptOutputs(LuaThread& thread, lua_State* L, int env) noexcept
 {
     auto app = OpenFunscripter::ptr;
     int32_t scriptCount = app->LoadedFunscripts.size();
     char tmp[1024];
 
     int32_t size;
-    int32_t at;
-    int32_t pos;
-    int32_t tag;
     int32_t newPosMs;
-    bool selected;
-    
     int32_t i;
-    int32_t actionCount;
-    int32_t actionIdx;
 
     thread.outputs.clear();
 
 #define CHECK_OR_FAIL(expr) if(!expr) goto failure
 
-    lua_getglobal(L, "LoadedScripts");
+    lua_getfield(L, env, "LoadedScripts");
     // global
     CHECK_OR_FAIL(lua_istable(L, -1));
 
@@ -703,46 +760,34 @@ bool CollectScriptOutputs(LuaThread& thread, lua_State* L) noexcept
         CHECK_OR_FAIL(lua_istable(L, -1));
 
         lua_getfield(L, -1, "actions"); // push actions array
-        CHECK_OR_FAIL(lua_istable(L, -1));
-
-        actionCount = lua_rawlen(L, -1);
-        for (actionIdx = 1; actionIdx <= actionCount; actionIdx++) {
-            lua_rawgeti(L, -1, actionIdx); // push single action
-            CHECK_OR_FAIL(lua_istable(L, -1));
-                
-            lua_getfield(L, -1, "at"); // push action
-            CHECK_OR_FAIL(lua_isnumber(L, -1));
-            at = lua_tonumber(L, -1);
-            lua_pop(L, 1); // pop at
-
-            lua_getfield(L, -1, "pos"); // push pos
-            CHECK_OR_FAIL(lua_isnumber(L, -1));
-            pos = lua_tonumber(L, -1);
-            lua_pop(L, 1); // pop pos
-
-            lua_getfield(L, -1, "selected"); // push selected
-            CHECK_OR_FAIL(lua_isboolean(L, -1));
-            selected = lua_toboolean(L, -1);
-            lua_pop(L, 1); // pop selected
-
-            lua_getfield(L, -1, "tag"); // push tag
-            CHECK_OR_FAIL(lua_isnumber(L, -1));
-            tag = lua_tonumber(L, -1);
-            lua_pop(L, 1); // pop tag
-
-            pos = Util::Clamp(pos, 0, 100);
-            at = std::max(at, 0);
-            tag = (uint8_t)tag;
-
-            currentScript.actions.insert(FunscriptAction(at, pos, tag));
-            if (selected) { currentScript.selection.insert(FunscriptAction(at, pos, tag)); }
-
-            lua_pop(L, 1); // pop single action
+        if (auto array = OFS::lua::ToActionArray(L, -1)) {
+            if (!array->Modified()) {
+                // the script didn't touch the actions
+                currentScript.changed = false;
+                lua_pop(L, 2); // pop actions array & script
+                continue;
+            }
+            currentScript.actions = std::move(*array->TakeModified());
+        }
+        else {
+            CHECK_OR_FAIL(OFS::lua::ReadActions(L, -1, currentScript.actions));
         }
         lua_pop(L, 2); // pop actions array & script
+
+        // scripts are allowed to add actions in any order
+        // identical actions (same at & pos) are merged like before
+        auto sameAction = [](auto a, auto b) { return a.at == b.at && a.pos == b.pos; };
+        std::stable_sort(currentScript.actions.begin(), currentScript.actions.end(),
+            [](auto a, auto b) { return a.at < b.at || (a.at == b.at && a.pos < b.pos); });
+        currentScript.actions.erase(
+            std::unique(currentScript.actions.begin(), currentScript.actions.end(), sameAction),
+            currentScript.actions.end());
+        for (auto action : currentScript.actions) {
+            if (action.IsSelected()) currentScript.selection.emplace_back(action);
+        }
     }
 
-    lua_getglobal(L, "CurrentTimeMs");
+    lua_getfield(L, env, "CurrentTimeMs");
     CHECK_OR_FAIL(lua_isnumber(L, -1));
     newPosMs = lua_tonumber(L, -1);
     thread.NewPositionMs = newPosMs == thread.NewPositionMs ? -1 : newPosMs;
@@ -761,18 +806,36 @@ void CustomLua::runScript(LuaScript* script, bool dry_run) noexcept
     Thread.dry_run = dry_run;
     Thread.script = script;
 
-    resetVM();
+    // the vm persists between runs only the inputs are prepared every time
+    if (Thread.L == nullptr) {
+        resetVM();
+    }
+    else {
+        SDL_AtomicLock(&SpinLock);
+        LuaConsoleBuffer.clear();
+        SDL_AtomicUnlock(&SpinLock);
+        WriteToConsole("Running " LUA_VERSION " ...");
+    }
+    prepareInputs();
+
     auto luaThread = [](void* user) -> int {
         LuaThread& data = *(LuaThread*)user;
         char tmp[1024];
+        bool collected = false;
+
+        lua_settop(data.L, 0);
+        const int env = PushRunEnvironment(data.L);
 
         WriteToConsole("============= SETUP =============");
         stbsp_snprintf(tmp, sizeof(tmp), "Loading %d actions\nand %d clipboard actions into lua...", Thread.TotalActionCount, Thread.ClipboardCount);
         WriteToConsole(tmp);
 
         auto startTime = std::chrono::high_resolution_clock::now();
-        int suc = luaL_dostring(data.L, data.setupScript.c_str()); 
-        FUN_ASSERT_F(suc == 0, "setup failed:\n%s", lua_tostring(Thread.L, -1));
+        if (!SetupScriptInputs(data, data.L)) {
+            WriteToConsole("ERROR: funscript.lua didn't load.");
+            data.running = false;
+            return 0;
+        }
         auto endTime = std::chrono::high_resolution_clock::now();
         auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(endTime - startTime);
       
@@ -784,7 +847,7 @@ void CustomLua::runScript(LuaScript* script, bool dry_run) noexcept
 
         WriteToConsole("============= RUN LUA =============");
         startTime = std::chrono::high_resolution_clock::now();
-        data.result = LuaDoFile(data.L, data.script->absolutePath.c_str());
+        data.result = LuaDoFile(data.L, data.script->absolutePath.c_str(), env);
         stbsp_snprintf(tmp, sizeof(tmp), "lua result: %d", data.result);
         WriteToConsole(tmp);
 
@@ -792,7 +855,6 @@ void CustomLua::runScript(LuaScript* script, bool dry_run) noexcept
             stbsp_snprintf(tmp, sizeof(tmp), "lua error: %s", lua_tostring(data.L, -1));
             WriteToConsole(tmp);
             LOG_ERROR(tmp);
-            data.running = false;
         }
         else {
             endTime = std::chrono::high_resolution_clock::now();
@@ -800,46 +862,47 @@ void CustomLua::runScript(LuaScript* script, bool dry_run) noexcept
             stbsp_snprintf(tmp, sizeof(tmp), "execution time: %ld ms", duration.count());
             WriteToConsole(tmp);
 
-            if (data.dry_run) {
-                data.running = false;
-                return 0;
+            if (!data.dry_run) {
+                collected = CollectScriptOutputs(data, data.L, env);
+                if (!collected) {
+                    WriteToConsole("ERROR: Failed to read script outputs.");
+                }
             }
+        }
 
-            if (CollectScriptOutputs(data, data.L)) {
-                // fire event to the main thread
-                EventSystem::SingleShot([](void* ctx) {
-                    // script finished handler
-                    // this code executes on the main thread during event processing
-                    LuaThread& data = *(LuaThread*)ctx;
-
-                    auto app = OpenFunscripter::ptr;
-                    std::vector<FunscriptAction> tmpBuffer;
-                    app->undoSystem->Snapshot(StateType::CUSTOM_LUA, true, app->ActiveFunscript().get());
-
-                    for (int i = 0; i < app->LoadedFunscripts.size(); i++) {
-                        auto& script = app->LoadedFunscripts[i];
-                        auto& output = data.outputs[i];
-
-                        tmpBuffer.clear();
-                        tmpBuffer.reserve(output.actions.size());
-                        tmpBuffer.insert(tmpBuffer.end(), output.actions.begin(), output.actions.end());
-                        script->SetActions(tmpBuffer);
-
-                        tmpBuffer.clear();
-                        tmpBuffer.insert(tmpBuffer.end(), output.selection.begin(), output.selection.end());
-                        script->SetSelection(tmpBuffer, true);
-                    }
+        // drop the environment of this run, the gc releases the snapshots
+        // this has to happen before running is reset since the vm gets reused
+        lua_settop(data.L, 0);
+        ClearScriptInputs(data.L);
+        lua_gc(data.L, LUA_GCCOLLECT, 0);
+
+        if (collected) {
+            // fire event to the main thread
+            EventSystem::SingleShot([](void* ctx) {
+                // script finished handler
+                // this code executes on the main thread during event processing
+                LuaThread& data = *(LuaThread*)ctx;
+
+                auto app = OpenFunscripter::ptr;
+                app->undoSystem->Snapshot(StateType::CUSTOM_LUA, true, app->ActiveFunscript().get());
+
+                for (int i = 0; i < app->LoadedFunscripts.size(); i++) {
+                    auto& script = app->LoadedFunscripts[i];
+                    auto& output = data.outputs[i];
+                    if (!output.changed) continue;
+                    script->SetActions(output.actions);
+                    script->SetSelection(output.selection);
+                }
+                data.outputs.clear();
 
-                    if (data.NewPositionMs >= 0) {
-                        app->player->setPositionExact(data.NewPositionMs);
-                    }
-                    data.running = false;
-                }, &data);
-            }
-            else {
-                WriteToConsole("ERROR: Failed to read script outputs.");
+                if (data.NewPositionMs >= 0) {
+                    app->player->setPositionExact(data.NewPositionMs);
+                }
                 data.running = false;
-            }
+            }, &data);
+        }
+        else {
+            data.running = false;
         }
         WriteToConsole("================ END ===============");
         return 0;
@@ -851,8 +914,11 @@ void CustomLua::runScript(LuaScript* script, bool dry_run) noexcept
 
 void CustomLua::DrawUI() noexcept
 {
-    if (ImGui::Button("Reload scripts", ImVec2(-1.f, 0.f))) { updateScripts(); }
-    Util::Tooltip("Reload scripts in the script directory.\nOnly has to be pressed when deleting or adding files.");
+    if (ImGui::Button("Reload scripts", ImVec2(-1.f, 0.f))) { 
+        updateScripts(); 
+        if (!Thread.running) resetVM();
+    }
+    Util::Tooltip("Reload scripts in the script directory & restart the lua vm.\nHas to be pressed when deleting or adding files or after changing required modules.");
 
     if (ImGui::Button("Script directory", ImVec2(-1.f, 0.f))) { Util::OpenFileExplorer(Util::Prefpath("lua").c_str()); }
     ImGui::Spacing(); ImGui::SeparatorEx(ImGuiSeparatorFlags_Horizontal); ImGui::Spacing();
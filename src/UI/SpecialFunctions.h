@@ -35,8 +35,20 @@ public:
 
 class RamerDouglasPeucker : public FunctionBase
 {
+	// the importance of the selection gets computed once on a worker thread
+	// changing epsilon is only a threshold filter after that
+	struct Simplification {
+		std::vector<FunscriptAction> points;
+		std::vector<float> importance;
+		uint32_t generation = 0;
+		bool computing = false;
+	};
+	// shared with the worker since this can get destroyed while it's running
+	std::shared_ptr<Simplification> simplification = std::make_shared<Simplification>();
 	float epsilon = 0.0f;
 	bool createUndoState = true;
+
+	void startComputation() noexcept;
 public:
 	RamerDouglasPeucker() noexcept;
 	virtual ~RamerDouglasPeucker() noexcept;
@@ -94,6 +106,7 @@ private:
 
 	void updateScripts() noexcept;
 	void resetVM() noexcept;
+	void prepareInputs() noexcept;
 	void runScript(LuaScript* script, bool dry_run = false) noexcept;
 public:
 	CustomLua() noexcept;
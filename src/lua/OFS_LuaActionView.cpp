@@ -0,0 +1,225 @@
+#include "OFS_LuaActionView.h"
+#include "OFS_LuaKernels.h"
+#include "OFS_Util.h"
+
+#include <new>
+#include <cstring>
+#include <algorithm>
+
+// lua is compiled as c++ and raises errors as exceptions
+// so nothing that can call luaL_error is noexcept
+
+static constexpr const char* ActionArrayMeta = "OFS.ActionArray";
+static constexpr const char* ActionRefMeta = "OFS.ActionRef";
+
+// a single action handed out by an ActionArray
+// holds a copy of the action and writes through to its position in the array
+// the array is kept alive through the first user value
+struct ActionRef {
+    int32_t index;
+    FunscriptAction value;
+};
+
+static void PushActionRef(lua_State* L, int arrayIdx, int32_t index) noexcept
+{
+    arrayIdx = lua_absindex(L, arrayIdx);
+    auto array = (OFS::lua::ActionArray*)lua_touserdata(L, arrayIdx);
+    auto ref = (ActionRef*)lua_newuserdatauv(L, sizeof(ActionRef), 1);
+    ref->index = index;
+    ref->value = array->Read()[index];
+    luaL_setmetatable(L, ActionRefMeta);
+    lua_pushvalue(L, arrayIdx);
+    lua_setiuservalue(L, -2, 1);
+}
+
+static int ActionArrayIndex(lua_State* L)
+{
+    auto array = (OFS::lua::ActionArray*)luaL_checkudata(L, 1, ActionArrayMeta);
+    if (lua_isinteger(L, 2)) {
+        auto idx = lua_tointeger(L, 2);
+        if (idx >= 1 && idx <= (lua_Integer)array->Read().size()) {
+            PushActionRef(L, 1, idx - 1); // !!! lua indexing starts at 1 !!!
+            return 1;
+        }
+    }
+    lua_pushnil(L);
+    return 1;
+}
+
+static int ActionArrayNewIndex(lua_State* L)
+{
+    auto array = (OFS::lua::ActionArray*)luaL_checkudata(L, 1, ActionArrayMeta);
+    auto idx = luaL_checkinteger(L, 2);
+    auto& actions = array->Write();
+    const lua_Integer size = actions.size();
+
+    if (lua_isnil(L, 3)) {
+        // table.remove ends with t[#t] = nil
+        if (idx != size) {
+            return luaL_error(L, "only the last action can be set to nil. use table.remove");
+        }
+        actions.pop_back();
+        return 0;
+    }
+
+    FunscriptAction action;
+    if (!OFS::lua::ToAction(L, 3, action)) {
+        return luaL_error(L, "expected an action with at & pos");
+    }
+    if (idx >= 1 && idx <= size) {
+        actions[idx - 1] = action;
+    }
+    else if (idx == size + 1) {
+        actions.emplace_back(action);
+    }
+    else {
+        return luaL_error(L, "action index %d out of range", (int)idx);
+    }
+    return 0;
+}
+
+static int ActionArrayLen(lua_State* L)
+{
+    auto array = (OFS::lua::ActionArray*)luaL_checkudata(L, 1, ActionArrayMeta);
+    lua_pushinteger(L, array->Read().size());
+    return 1;
+}
+
+static int ActionArrayNext(lua_State* L)
+{
+    auto array = (OFS::lua::ActionArray*)luaL_checkudata(L, 1, ActionArrayMeta);
+    auto idx = luaL_checkinteger(L, 2) + 1;
+    if (idx > (lua_Integer)array->Read().size()) {
+        lua_pushnil(L);
+        return 1;
+    }
+    lua_pushinteger(L, idx);
+    PushActionRef(L, 1, idx - 1);
+    return 2;
+}
+
+static int ActionArrayPairs(lua_State* L)
+{
+    luaL_checkudata(L, 1, ActionArrayMeta);
+    lua_pushcfunction(L, ActionArrayNext);
+    lua_pushvalue(L, 1);
+    lua_pushinteger(L, 0);
+    return 3;
+}
+
+static int ActionArrayGC(lua_State* L)
+{
+    auto array = (OFS::lua::ActionArray*)luaL_checkudata(L, 1, ActionArrayMeta);
+    array->~ActionArray();
+    return 0;
+}
+
+static int ActionRefIndex(lua_State* L)
+{
+    auto ref = (ActionRef*)luaL_checkudata(L, 1, ActionRefMeta);
+    const char* key = luaL_checkstring(L, 2);
+    if (strcmp(key, "at") == 0) lua_pushinteger(L, ref->value.at);
+    else if (strcmp(key, "pos") == 0) lua_pushinteger(L, ref->value.pos);
+    else if (strcmp(key, "selected") == 0) lua_pushboolean(L, ref->value.IsSelected());
+    else if (strcmp(key, "tag") == 0) lua_pushinteger(L, ref->value.tag);
+    else {
+        // anything else is looked up in the Action table from funscript.lua
+        lua_getglobal(L, "Action");
+        lua_getfield(L, -1, key);
+        lua_remove(L, -2);
+    }
+    return 1;
+}
+
+static int ActionRefNewIndex(lua_State* L)
+{
+    auto ref = (ActionRef*)luaL_checkudata(L, 1, ActionRefMeta);
+    const char* key = luaL_checkstring(L, 2);
+    if (strcmp(key, "at") == 0) ref->value.at = std::max((int32_t)luaL_checknumber(L, 3), 0);
+    else if (strcmp(key, "pos") == 0) ref->value.pos = Util::Clamp((int32_t)luaL_checknumber(L, 3), 0, 100);
+    else if (strcmp(key, "selected") == 0) ref->value.SetSelected(lua_toboolean(L, 3));
+    else if (strcmp(key, "tag") == 0) ref->value.tag = (uint8_t)luaL_checknumber(L, 3);
+    else return luaL_error(L, "actions don't have a field called \"%s\"", key);
+
+    lua_getiuservalue(L, 1, 1);
+    auto array = (OFS::lua::ActionArray*)lua_touserdata(L, -1);
+    auto& actions = array->Write();
+    if (ref->index < actions.size()) {
+        actions[ref->index] = ref->value;
+    }
+    lua_pop(L, 1);
+    return 0;
+}
+
+static int ActionRefToString(lua_State* L)
+{
+    auto ref = (ActionRef*)luaL_checkudata(L, 1, ActionRefMeta);
+    lua_pushfstring(L, "at:%d pos:%d", (int)ref->value.at, (int)ref->value.pos);
+    return 1;
+}
+
+static constexpr struct luaL_Reg actionArrayMeta[] = {
+    {"__index", ActionArrayIndex},
+    {"__newindex", ActionArrayNewIndex},
+    {"__len", ActionArrayLen},
+    {"__pairs", ActionArrayPairs},
+    {"__gc", ActionArrayGC},
+    {NULL, NULL} /* end of array */
+};
+
+static constexpr struct luaL_Reg actionRefMeta[] = {
+    {"__index", ActionRefIndex},
+    {"__newindex", ActionRefNewIndex},
+    {"__tostring", ActionRefToString},
+    {NULL, NULL} /* end of array */
+};
+
+void OFS::lua::RegisterActionView(lua_State* L) noexcept
+{
+    luaL_newmetatable(L, ActionArrayMeta);
+    luaL_setfuncs(L, actionArrayMeta, 0);
+    lua_pop(L, 1);
+
+    luaL_newmetatable(L, ActionRefMeta);
+    luaL_setfuncs(L, actionRefMeta, 0);
+    lua_pop(L, 1);
+}
+
+OFS::lua::ActionArray* OFS::lua::PushActionArray(lua_State* L, std::shared_ptr<const std::vector<FunscriptAction>> snapshot) noexcept
+{
+    auto array = (ActionArray*)lua_newuserdatauv(L, sizeof(ActionArray), 0);
+    new (array) ActionArray(std::move(snapshot));
+    luaL_setmetatable(L, ActionArrayMeta);
+    return array;
+}
+
+OFS::lua::ActionArray* OFS::lua::ToActionArray(lua_State* L, int idx) noexcept
+{
+    return (ActionArray*)luaL_testudata(L, idx, ActionArrayMeta);
+}
+
+bool OFS::lua::ToAction(lua_State* L, int idx, FunscriptAction& action) noexcept
+{
+    if (auto ref = (ActionRef*)luaL_testudata(L, idx, ActionRefMeta)) {
+        action = ref->value;
+        return true;
+    }
+    if (!lua_istable(L, idx)) return false;
+
+    idx = lua_absindex(L, idx);
+    lua_getfield(L, idx, "at");
+    lua_getfield(L, idx, "pos");
+    lua_getfield(L, idx, "selected");
+    lua_getfield(L, idx, "tag");
+    bool valid = lua_isnumber(L, -4) && lua_isnumber(L, -3);
+    if (valid) {
+        int32_t at = lua_tonumber(L, -4);
+        int32_t pos = lua_tonumber(L, -3);
+        bool selected = lua_toboolean(L, -2);
+        int32_t tag = lua_isnumber(L, -1) ? lua_tonumber(L, -1) : 0;
+        action = FunscriptAction(std::max(at, 0), Util::Clamp(pos, 0, 100), (uint8_t)tag);
+        action.SetSelected(selected);
+    }
+    lua_pop(L, 4);
+    return valid;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "OFS_Lua.h"
+#include "FunscriptAction.h"
+
+#include <vector>
+#include <memory>
+
+// exposes action vectors to lua as userdata instead of one table per action
+// lua sees an array of actions which supports #, ipairs, pairs, table.insert/remove/sort
+// reading only touches the shared snapshot, the first write copies it (copy-on-write)
+namespace OFS
+{
+	namespace lua
+	{
+		class ActionArray
+		{
+			std::shared_ptr<const std::vector<FunscriptAction>> snapshot;
+			std::shared_ptr<std::vector<FunscriptAction>> modified;
+		public:
+			ActionArray(std::shared_ptr<const std::vector<FunscriptAction>>&& snapshot) noexcept
+				: snapshot(std::move(snapshot)) {}
+
+			inline const std::vector<FunscriptAction>& Read() const noexcept { return modified ? *modified : *snapshot; }
+			inline std::vector<FunscriptAction>& Write() noexcept {
+				if (!modified) modified = std::make_shared<std::vector<FunscriptAction>>(*snapshot);
+				return *modified;
+			}
+			// replaces everything without copying the snapshot first
+			inline void Assign(std::vector<FunscriptAction>&& actions) noexcept {
+				if (modified) *modified = std::move(actions);
+				else modified = std::make_shared<std::vector<FunscriptAction>>(std::move(actions));
+			}
+			inline bool Modified() const noexcept { return modified != nullptr; }
+			inline std::shared_ptr<std::vector<FunscriptAction>> TakeModified() noexcept { return std::move(modified); }
+		};
+
+		// creates the metatables, has to be called once per lua_State
+		void RegisterActionView(lua_State* L) noexcept;
+
+		ActionArray* PushActionArray(lua_State* L, std::shared_ptr<const std::vector<FunscriptAction>> snapshot) noexcept;
+		// nullptr if the value at idx isn't an ActionArray
+		ActionArray* ToActionArray(lua_State* L, int idx) noexcept;
+		// reads a single action from an element of an ActionArray or an Action table
+		bool ToAction(lua_State* L, int idx, FunscriptAction& action) noexcept;
+	}
+}
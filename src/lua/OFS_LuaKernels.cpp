@@ -0,0 +1,340 @@
+#include "OFS_LuaKernels.h"
+#include "OFS_LuaActionView.h"
+#include "OFS_Util.h"
+
+#include <algorithm>
+#include <random>
+#include <cmath>
+
+float OFS::lua::Ease(Easing easing, float x) noexcept
+{
+    // https://easings.net/
+    constexpr float pi = 3.14159265358979f;
+    switch (easing) {
+    case Easing::EaseInSine: return 1.f - std::cos((x * pi) / 2.f);
+    case Easing::EaseOutSine: return std::sin((x * pi) / 2.f);
+    case Easing::EaseInOutSine: return -(std::cos(pi * x) - 1.f) / 2.f;
+    case Easing::EaseInQuad: return x * x;
+    case Easing::EaseOutQuad: return 1.f - (1.f - x) * (1.f - x);
+    case Easing::EaseInOutQuad: return x < 0.5f ? 2.f * x * x : 1.f - std::pow(-2.f * x + 2.f, 2.f) / 2.f;
+    case Easing::EaseInCubic: return x * x * x;
+    case Easing::EaseOutCubic: return 1.f - std::pow(1.f - x, 3.f);
+    case Easing::EaseInOutCubic: return x < 0.5f ? 4.f * x * x * x : 1.f - std::pow(-2.f * x + 2.f, 3.f) / 2.f;
+    case Easing::Linear:
+    default:
+        return x;
+    }
+}
+
+inline static int32_t ClampPos(float pos) noexcept
+{
+    return Util::Clamp((int32_t)std::round(pos), 0, 100);
+}
+
+inline static void SortActions(std::vector<FunscriptAction>& actions) noexcept
+{
+    std::stable_sort(actions.begin(), actions.end());
+}
+
+// merges sorted newActions into actions
+// where both have an action with the same timestamp the existing one is kept
+static void MergeActions(std::vector<FunscriptAction>& actions, const std::vector<FunscriptAction>& newActions) noexcept
+{
+    if (newActions.empty()) return;
+    std::vector<FunscriptAction> merged;
+    merged.reserve(actions.size() + newActions.size());
+
+    auto it = actions.begin();
+    auto newIt = newActions.begin();
+    while (it != actions.end() && newIt != newActions.end()) {
+        if (newIt->at < it->at) {
+            merged.emplace_back(*newIt++);
+        }
+        else {
+            if (newIt->at == it->at) newIt++;
+            merged.emplace_back(*it++);
+        }
+    }
+    merged.insert(merged.end(), it, actions.end());
+    merged.insert(merged.end(), newIt, newActions.end());
+    actions = std::move(merged);
+}
+
+void OFS::lua::InterpolateSelection(std::vector<FunscriptAction>& actions, int32_t stepMs, Easing easing) noexcept
+{
+    if (stepMs <= 0) return;
+    std::vector<FunscriptAction> newActions;
+    const FunscriptAction* prev = nullptr;
+    for (auto& action : actions) {
+        if (!action.IsSelected()) continue;
+        if (prev != nullptr) {
+            const int32_t duration = action.at - prev->at;
+            const int32_t pointCount = (int32_t)std::round(duration / (float)stepMs) - 1;
+            for (int32_t i = 1; i <= pointCount; i++) {
+                const float progress = i / (float)(pointCount + 1);
+                const float pos = prev->pos + (action.pos - prev->pos) * Ease(easing, progress);
+                auto& newAction = newActions.emplace_back(prev->at + i * stepMs, ClampPos(pos));
+                newAction.SetSelected(true);
+            }
+        }
+        prev = &action;
+    }
+    MergeActions(actions, newActions);
+}
+
+void OFS::lua::OffsetSelection(std::vector<FunscriptAction>& actions, int32_t timeMs, int32_t pos) noexcept
+{
+    for (auto& action : actions) {
+        if (!action.IsSelected()) continue;
+        action.at = std::max(action.at + timeMs, 0);
+        action.pos = Util::Clamp(action.pos + pos, 0, 100);
+    }
+    if (timeMs != 0) SortActions(actions);
+}
+
+void OFS::lua::ScaleSelection(std::vector<FunscriptAction>& actions, float factor, float center) noexcept
+{
+    for (auto& action : actions) {
+        if (!action.IsSelected()) continue;
+        action.pos = ClampPos(center + (action.pos - center) * factor);
+    }
+}
+
+void OFS::lua::ClampSelection(std::vector<FunscriptAction>& actions, int32_t minPos, int32_t maxPos) noexcept
+{
+    minPos = Util::Clamp(minPos, 0, 100);
+    maxPos = Util::Clamp(maxPos, minPos, 100);
+    for (auto& action : actions) {
+        if (!action.IsSelected()) continue;
+        action.pos = Util::Clamp((int32_t)action.pos, minPos, maxPos);
+    }
+}
+
+void OFS::lua::ResampleSelection(std::vector<FunscriptAction>& actions, int32_t intervalMs) noexcept
+{
+    if (intervalMs <= 0) return;
+    std::vector<FunscriptAction> selection;
+    for (auto action : actions) {
+        if (action.IsSelected()) selection.emplace_back(action);
+    }
+    if (selection.size() < 2) return;
+
+    const int32_t startMs = selection.front().at;
+    const int32_t endMs = selection.back().at;
+    std::vector<FunscriptAction> samples;
+    samples.reserve((endMs - startMs) / intervalMs + 2);
+
+    size_t segment = 0;
+    for (int32_t timeMs = startMs; timeMs < endMs; timeMs += intervalMs) {
+        while (selection[segment + 1].at <= timeMs) segment++;
+        auto& a = selection[segment];
+        auto& b = selection[segment + 1];
+        const float t = (timeMs - a.at) / (float)(b.at - a.at);
+        samples.emplace_back(timeMs, ClampPos(a.pos + (b.pos - a.pos) * t)).SetSelected(true);
+    }
+    samples.emplace_back(selection.back()).SetSelected(true);
+
+    actions.erase(std::remove_if(actions.begin(), actions.end(),
+        [](auto action) { return action.IsSelected(); }), actions.end());
+    MergeActions(actions, samples);
+}
+
+void OFS::lua::JitterSelection(std::vector<FunscriptAction>& actions, int32_t timeMs, int32_t pos, uint32_t seed) noexcept
+{
+    timeMs = std::abs(timeMs);
+    pos = std::abs(pos);
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int32_t> timeDist(-timeMs, timeMs);
+    std::uniform_int_distribution<int32_t> posDist(-pos, pos);
+    for (auto& action : actions) {
+        if (!action.IsSelected()) continue;
+        action.at = std::max(action.at + timeDist(rng), 0);
+        action.pos = Util::Clamp(action.pos + posDist(rng), 0, 100);
+    }
+    SortActions(actions);
+}
+
+bool OFS::lua::ReadActions(lua_State* L, int idx, std::vector<FunscriptAction>& actions) noexcept
+{
+    idx = lua_absindex(L, idx);
+    if (auto array = ToActionArray(L, idx)) {
+        actions = array->Read();
+        return true;
+    }
+    if (!lua_istable(L, idx)) return false;
+
+    const int32_t actionCount = lua_rawlen(L, idx);
+    actions.clear();
+    actions.reserve(actionCount);
+    for (int32_t i = 1; i <= actionCount; i++) {
+        lua_rawgeti(L, idx, i); // push single action
+        bool valid = ToAction(L, -1, actions.emplace_back());
+        lua_pop(L, 1); // pop single action
+        if (!valid) return false;
+    }
+    return true;
+}
+
+void OFS::lua::PushActions(lua_State* L, int actionMeta, const std::vector<FunscriptAction>& actions, bool withSelection) noexcept
+{
+    lua_createtable(L, actions.size(), 0);
+    for (int i = 0; i < actions.size(); i++) {
+        auto action = actions[i];
+        lua_createtable(L, 0, 4);
+        lua_pushinteger(L, action.at);
+        lua_setfield(L, -2, "at");
+        lua_pushinteger(L, action.pos);
+        lua_setfield(L, -2, "pos");
+        lua_pushboolean(L, withSelection && action.IsSelected());
+        lua_setfield(L, -2, "selected");
+        lua_pushinteger(L, action.tag);
+        lua_setfield(L, -2, "tag");
+        lua_pushvalue(L, actionMeta);
+        lua_setmetatable(L, -2);
+        lua_rawseti(L, -2, i + 1); // !!! lua indexing starts at 1 !!!
+    }
+}
+
+// lua is compiled as c++ and raises errors as exceptions
+// so nothing that can call luaL_error is noexcept
+
+// self.actions -> vector
+static void GetScriptActions(lua_State* L, std::vector<FunscriptAction>& actions)
+{
+    luaL_checktype(L, 1, LUA_TTABLE);
+    lua_getfield(L, 1, "actions");
+    if (!OFS::lua::ReadActions(L, -1, actions)) {
+        luaL_error(L, "invalid actions. every action needs at & pos.");
+    }
+    lua_pop(L, 1);
+    if (!std::is_sorted(actions.begin(), actions.end())) {
+        // AddActionUnordered
+        SortActions(actions);
+    }
+}
+
+// vector -> self.actions
+// this replaces all actions, references to the old ones are stale afterwards
+static void SetScriptActions(lua_State* L, std::vector<FunscriptAction>&& actions)
+{
+    lua_getfield(L, 1, "actions");
+    if (auto array = OFS::lua::ToActionArray(L, -1)) {
+        // the script still uses the view handed out by OFS
+        array->Assign(std::move(actions));
+        lua_pop(L, 1);
+        return;
+    }
+    lua_pop(L, 1);
+
+    lua_getglobal(L, "Action");
+    OFS::lua::PushActions(L, lua_gettop(L), actions, true);
+    lua_setfield(L, 1, "actions");
+    lua_pop(L, 1); // pop Action
+}
+
+static constexpr const char* EasingNames[] = {
+    "linear",
+    "easeInSine",
+    "easeOutSine",
+    "easeInOutSine",
+    "easeInQuad",
+    "easeOutQuad",
+    "easeInOutQuad",
+    "easeInCubic",
+    "easeOutCubic",
+    "easeInOutCubic",
+    NULL
+};
+
+// Funscript:InterpolateSelection(stepMs, easing)
+static int LuaInterpolateSelection(lua_State* L)
+{
+    std::vector<FunscriptAction> actions;
+    GetScriptActions(L, actions);
+    int32_t stepMs = luaL_checknumber(L, 2);
+    auto easing = (OFS::lua::Easing)luaL_checkoption(L, 3, "linear", EasingNames);
+    OFS::lua::InterpolateSelection(actions, stepMs, easing);
+    SetScriptActions(L, std::move(actions));
+    return 0;
+}
+
+// Funscript:OffsetSelection(timeMs, pos)
+static int LuaOffsetSelection(lua_State* L)
+{
+    std::vector<FunscriptAction> actions;
+    GetScriptActions(L, actions);
+    int32_t timeMs = luaL_checknumber(L, 2);
+    int32_t pos = luaL_optnumber(L, 3, 0);
+    OFS::lua::OffsetSelection(actions, timeMs, pos);
+    SetScriptActions(L, std::move(actions));
+    return 0;
+}
+
+// Funscript:ScaleSelection(factor, center = 50)
+static int LuaScaleSelection(lua_State* L)
+{
+    std::vector<FunscriptAction> actions;
+    GetScriptActions(L, actions);
+    float factor = luaL_checknumber(L, 2);
+    float center = luaL_optnumber(L, 3, 50);
+    OFS::lua::ScaleSelection(actions, factor, center);
+    SetScriptActions(L, std::move(actions));
+    return 0;
+}
+
+// Funscript:ClampSelection(minPos, maxPos)
+static int LuaClampSelection(lua_State* L)
+{
+    std::vector<FunscriptAction> actions;
+    GetScriptActions(L, actions);
+    int32_t minPos = luaL_checknumber(L, 2);
+    int32_t maxPos = luaL_checknumber(L, 3);
+    OFS::lua::ClampSelection(actions, minPos, maxPos);
+    SetScriptActions(L, std::move(actions));
+    return 0;
+}
+
+// Funscript:ResampleSelection(intervalMs)
+static int LuaResampleSelection(lua_State* L)
+{
+    std::vector<FunscriptAction> actions;
+    GetScriptActions(L, actions);
+    int32_t intervalMs = luaL_checknumber(L, 2);
+    OFS::lua::ResampleSelection(actions, intervalMs);
+    SetScriptActions(L, std::move(actions));
+    return 0;
+}
+
+// Funscript:JitterSelection(timeMs, pos, seed = random)
+static int LuaJitterSelection(lua_State* L)
+{
+    std::vector<FunscriptAction> actions;
+    GetScriptActions(L, actions);
+    int32_t timeMs = luaL_checknumber(L, 2);
+    int32_t pos = luaL_checknumber(L, 3);
+    uint32_t seed = lua_isnoneornil(L, 4)
+        ? std::random_device()()
+        : (uint32_t)(int64_t)luaL_checknumber(L, 4);
+    OFS::lua::JitterSelection(actions, timeMs, pos, seed);
+    SetScriptActions(L, std::move(actions));
+    return 0;
+}
+
+static constexpr struct luaL_Reg kernellib[] = {
+    {"InterpolateSelection", LuaInterpolateSelection},
+    {"OffsetSelection", LuaOffsetSelection},
+    {"ScaleSelection", LuaScaleSelection},
+    {"ClampSelection", LuaClampSelection},
+    {"ResampleSelection", LuaResampleSelection},
+    {"JitterSelection", LuaJitterSelection},
+    {NULL, NULL} /* end of array */
+};
+
+void OFS::lua::RegisterKernels(lua_State* L) noexcept
+{
+    lua_getglobal(L, "Funscript");
+    if (lua_istable(L, -1)) {
+        luaL_setfuncs(L, kernellib, 0);
+    }
+    lua_pop(L, 1);
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "OFS_Lua.h"
+#include "FunscriptAction.h"
+
+#include <vector>
+#include <cstdint>
+
+// native batch operations which are exposed to lua scripts as Funscript methods
+// looping over every action in lua is fine for a couple hundred actions but crawls on big selections
+// the kernels work on contiguous action arrays, the selection is FunscriptAction::Flags::Selected
+namespace OFS
+{
+	namespace lua
+	{
+		enum class Easing : int32_t
+		{
+			Linear,
+			EaseInSine,
+			EaseOutSine,
+			EaseInOutSine,
+			EaseInQuad,
+			EaseOutQuad,
+			EaseInOutQuad,
+			EaseInCubic,
+			EaseOutCubic,
+			EaseInOutCubic,
+		};
+		float Ease(Easing easing, float x) noexcept;
+
+		// all kernels expect the actions ordered by timestamp and keep them ordered
+		// adds points every stepMs between two consecutive selected actions, the new points are selected
+		void InterpolateSelection(std::vector<FunscriptAction>& actions, int32_t stepMs, Easing easing) noexcept;
+		void OffsetSelection(std::vector<FunscriptAction>& actions, int32_t timeMs, int32_t pos) noexcept;
+		void ScaleSelection(std::vector<FunscriptAction>& actions, float factor, float center) noexcept;
+		void ClampSelection(std::vector<FunscriptAction>& actions, int32_t minPos, int32_t maxPos) noexcept;
+		// replaces the selection with points every intervalMs sampled from the selected actions
+		void ResampleSelection(std::vector<FunscriptAction>& actions, int32_t intervalMs) noexcept;
+		// uniform random offsets in the range [-timeMs, timeMs] & [-pos, pos]
+		void JitterSelection(std::vector<FunscriptAction>& actions, int32_t timeMs, int32_t pos, uint32_t seed) noexcept;
+
+		// reads an ActionArray or an array of Action tables at idx
+		bool ReadActions(lua_State* L, int idx, std::vector<FunscriptAction>& actions) noexcept;
+		// pushes an array of Action tables onto the stack
+		// actionMeta is the absolute stack index of the Action metatable
+		void PushActions(lua_State* L, int actionMeta, const std::vector<FunscriptAction>& actions, bool withSelection) noexcept;
+
+		// adds the kernels to the Funscript table from funscript.lua
+		void RegisterKernels(lua_State* L) noexcept;
+	}
+}